@@ -1,14 +1,13 @@
 #ifndef KDTREE2D_H
 #define KDTREE2D_H
 
-#define KDTREE_DEFINE_OSTREAM_OPERATORS
-
 #include <functional>
 #include <iostream>
+#include <vector>
+#include <stdint.h>
 
 #include "kdtree++/kdtree.hpp"
-
-class RRTNode;
+#include "node_pool.h"
 
 class POS2D {
 public:
@@ -50,14 +49,15 @@ public:
     value_type d[2];
 };
 
+// the payload is the index of the RRTNode in the node arena of the planner
 class KDNode2D : public POS2D {
 public:
-    KDNode2D(value_type x, value_type y) : POS2D(x, y) { mpRRTNode = NULL; }
-    KDNode2D(POS2D & pos) : POS2D(pos) { mpRRTNode = NULL; }
-    void setRRTNode(RRTNode* pNode) { mpRRTNode = pNode; }
-    RRTNode* getRRTNode() { return mpRRTNode; }
+    KDNode2D(value_type x, value_type y) : POS2D(x, y) { mNodeIndex = 0; }
+    KDNode2D(POS2D & pos) : POS2D(pos) { mNodeIndex = 0; }
+    void setNodeIndex(uint32_t index) { mNodeIndex = index; }
+    uint32_t getNodeIndex() const { return mNodeIndex; }
 protected:
-    RRTNode* mpRRTNode;
+    uint32_t mNodeIndex;
 };
 
 
@@ -70,8 +70,79 @@ inline std::ostream& operator<<(std::ostream& out, KDNode2D const& T) {
     return out << '(' << T.d[0] << ',' << T.d[1] << ')';
 }
 
-inline double tac( KDNode2D t, size_t k ) { return t[k]; }
+// coordinate k of a node, as kdtree++ reads it
+struct KDTree2DAccessor {
+    typedef double result_type;
+    result_type operator()( KDNode2D const& t, size_t k ) const { return t.d[k]; }
+};
+
+typedef KDTree::_Node<KDNode2D> KDTree2DNode;
+typedef KDTree::squared_difference<double,double> KDTree2DDistance;
+typedef KDTree::KDTree<2, KDNode2D, KDTree2DAccessor,
+                       KDTree2DDistance, std::less<double>,
+                       PoolAllocator<KDTree2DNode> > KDTree2DBase;
+
+class KDTree2D : public KDTree2DBase {
+public:
+    // nodes come from p_pool if given, it must outlive the tree
+    explicit KDTree2D( NodePool* p_pool = NULL )
+        : KDTree2DBase( KDTree2DAccessor(), KDTree2DDistance(), std::less<double>(), PoolAllocator<KDTree2DNode>( p_pool ) ) {}
+
+    /*
+     * Empties the tree without visiting its nodes, for when their pool is
+     * reset right after. Otherwise the nodes leak.
+     */
+    void release_nodes() {
+        _M_set_leftmost( &_M_header );
+        _M_set_rightmost( &_M_header );
+        _M_set_root( NULL );
+        _M_count = 0;
+    }
+
+    /*
+     * find_within_range() returns every point of the axis-aligned box of
+     * half-width range. This returns only the points whose Euclidean
+     * distance to pos is at most radius, and skips a subtree as soon as
+     * the squared distance from pos to its cell exceeds radius^2. The node
+     * indices of the points are appended to node_indices.
+     */
+    void find_within_radius( POS2D const& pos, double radius, std::vector<uint32_t>& node_indices ) const {
+        if( _M_get_root() ) {
+            double offset[2] = { 0.0, 0.0 };
+            _find_within_radius( _M_get_root(), 0, pos, radius*radius, offset, 0.0, node_indices );
+        }
+    }
 
-typedef KDTree::KDTree<2, KDNode2D, std::pointer_to_binary_function<KDNode2D,size_t,double> > KDTree2D;
+protected:
+    void _find_within_radius( _Link_const_type node, size_t level, POS2D const& pos,
+                              double radius_sq, double offset[2], double cell_dist_sq,
+                              std::vector<uint32_t>& node_indices ) const {
+        KDNode2D const& value = _S_value( node );
+        double dx = (double)( value.d[0] - pos.d[0] );
+        double dy = (double)( value.d[1] - pos.d[1] );
+        if( dx*dx + dy*dy <= radius_sq ) {
+            node_indices.push_back( value.getNodeIndex() );
+        }
+
+        size_t dim = level % 2;
+        double split_offset = (double)( pos.d[dim] - value.d[dim] );
+        _Link_const_type near_child = split_offset < 0 ? _S_left( node ) : _S_right( node );
+        _Link_const_type far_child = split_offset < 0 ? _S_right( node ) : _S_left( node );
+
+        if( near_child ) {
+            _find_within_radius( near_child, level+1, pos, radius_sq, offset, cell_dist_sq, node_indices );
+        }
+        if( far_child ) {
+            // the far cell is at least |split_offset| away along dim
+            double old_offset = offset[dim];
+            double far_dist_sq = cell_dist_sq - old_offset*old_offset + split_offset*split_offset;
+            if( far_dist_sq <= radius_sq ) {
+                offset[dim] = split_offset;
+                _find_within_radius( far_child, level+1, pos, radius_sq, offset, far_dist_sq, node_indices );
+                offset[dim] = old_offset;
+            }
+        }
+    }
+};
 
 #endif // KDTREE2D_H
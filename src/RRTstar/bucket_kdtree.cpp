@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <limits>
+
+#include "bucket_kdtree.h"
+
+// far enough that no real point is ever nearer to a query than it
+static const int32_t SENTINEL_COORD = 1 << 29;
+// smaller subtrees are left unbalanced, rebuilding them would not pay off
+static const unsigned int MIN_REBUILD_SIZE = 4 * BucketKDTree::BUCKET_SIZE;
+
+const double BucketKDTree::BALANCE_ALPHA = 0.7;
+
+BucketKDTree::BucketKDTree() {
+    _size = 0;
+    _rebuilt_point_num = 0;
+}
+
+void BucketKDTree::clear() {
+    _nodes.clear();
+    _buckets.clear();
+    _free_nodes.clear();
+    _free_buckets.clear();
+    _size = 0;
+    _rebuilt_point_num = 0;
+}
+
+void BucketKDTree::reserve( unsigned int point_num ) {
+    // leaves end up holding 20 to 25 points, whatever the insertion order
+    unsigned int leaf_num = point_num / ( BUCKET_SIZE / 2 ) + 1;
+    _nodes.reserve( 2 * leaf_num );
+    _buckets.reserve( leaf_num );
+    _free_nodes.reserve( 2 * leaf_num );
+    _free_buckets.reserve( leaf_num );
+    _insert_path.reserve( 64 );
+    _rebuild_points.reserve( point_num );
+}
+
+int BucketKDTree::_create_node() {
+    Node node;
+    node.m_min[0] = node.m_min[1] = std::numeric_limits<int32_t>::max();
+    node.m_max[0] = node.m_max[1] = std::numeric_limits<int32_t>::min();
+    node.m_split_dim = -1;
+    node.m_split_value = 0;
+    node.m_child[0] = node.m_child[1] = -1;
+    node.m_size = 0;
+    if( false == _free_nodes.empty() ) {
+        int node_idx = _free_nodes.back();
+        _free_nodes.pop_back();
+        _nodes[node_idx] = node;
+        return node_idx;
+    }
+    _nodes.push_back( node );
+    return _nodes.size() - 1;
+}
+
+int BucketKDTree::_create_bucket() {
+    int bucket_idx = 0;
+    if( false == _free_buckets.empty() ) {
+        bucket_idx = _free_buckets.back();
+        _free_buckets.pop_back();
+    }
+    else {
+        bucket_idx = _buckets.size();
+        _buckets.push_back( Bucket() );
+    }
+    Bucket& bucket = _buckets[bucket_idx];
+    std::fill( bucket.m_x, bucket.m_x + BUCKET_SIZE, SENTINEL_COORD );
+    std::fill( bucket.m_y, bucket.m_y + BUCKET_SIZE, SENTINEL_COORD );
+    std::fill( bucket.m_payload, bucket.m_payload + BUCKET_SIZE, 0 );
+    bucket.m_size = 0;
+    return bucket_idx;
+}
+
+int BucketKDTree::_create_leaf() {
+    int bucket_idx = _create_bucket();
+    int node_idx = _create_node();
+    _nodes[node_idx].m_child[0] = bucket_idx;
+    return node_idx;
+}
+
+bool BucketKDTree::insert( POS2D pos, uint32_t payload ) {
+    if( _nodes.empty() ) {
+        _create_leaf();
+    }
+    int node_idx = 0;
+    _insert_path.clear();
+    while( true ) {
+        Node& node = _nodes[node_idx];
+        for( int dim=0; dim<2; dim++ ) {
+            node.m_min[dim] = std::min( node.m_min[dim], pos.d[dim] );
+            node.m_max[dim] = std::max( node.m_max[dim], pos.d[dim] );
+        }
+        if( node.m_split_dim >= 0 ) {
+            _insert_path.push_back( node_idx );
+            node_idx = node.m_child[ pos.d[node.m_split_dim] >= node.m_split_value ? 1 : 0 ];
+            continue;
+        }
+
+        Bucket& bucket = _buckets[node.m_child[0]];
+        if( bucket.m_size < BUCKET_SIZE ) {
+            bucket.m_x[bucket.m_size] = pos.d[0];
+            bucket.m_y[bucket.m_size] = pos.d[1];
+            bucket.m_payload[bucket.m_size] = payload;
+            bucket.m_size++;
+            node.m_size++;
+            break;
+        }
+        if( node.m_min[0] == node.m_max[0] && node.m_min[1] == node.m_max[1] ) {
+            // a full bucket of copies of pos cannot be split
+            return false;
+        }
+        // a full leaf becomes an inner node, the point then goes on into one of its halves
+        _split_leaf( node_idx );
+    }
+    _size++;
+
+    // the point is counted on its way down, the highest node it unbalanced is rebuilt
+    for( unsigned int i=0; i<_insert_path.size(); i++ ) {
+        _nodes[_insert_path[i]].m_size++;
+    }
+    for( unsigned int i=0; i<_insert_path.size(); i++ ) {
+        const Node& node = _nodes[_insert_path[i]];
+        if( node.m_size < MIN_REBUILD_SIZE ) {
+            break;
+        }
+        uint32_t max_child_size = std::max( _nodes[node.m_child[0]].m_size, _nodes[node.m_child[1]].m_size );
+        if( max_child_size > BALANCE_ALPHA * node.m_size ) {
+            _rebuild( _insert_path[i] );
+            break;
+        }
+    }
+    return true;
+}
+
+void BucketKDTree::_split_leaf( int node_idx ) {
+    int32_t min[2] = { _nodes[node_idx].m_min[0], _nodes[node_idx].m_min[1] };
+    int32_t max[2] = { _nodes[node_idx].m_max[0], _nodes[node_idx].m_max[1] };
+    int bucket_idx = _nodes[node_idx].m_child[0];
+
+    // split the wider side at the median, points on the split go right
+    Bucket old_bucket = _buckets[bucket_idx];
+    int dim = ( max[0] - min[0] >= max[1] - min[1] ) ? 0 : 1;
+    const int32_t* p_coords = ( dim == 0 ) ? old_bucket.m_x : old_bucket.m_y;
+    int32_t values[BUCKET_SIZE];
+    std::copy( p_coords, p_coords + old_bucket.m_size, values );
+    std::nth_element( values, values + old_bucket.m_size / 2, values + old_bucket.m_size );
+    int32_t split_value = values[old_bucket.m_size / 2];
+    if( split_value == min[dim] ) {
+        // the lower half would be empty, split just above the minimum instead
+        split_value = max[dim];
+        for( int i=0; i<old_bucket.m_size; i++ ) {
+            if( p_coords[i] > min[dim] && p_coords[i] < split_value ) {
+                split_value = p_coords[i];
+            }
+        }
+    }
+
+    int left_idx = _create_leaf();
+    int right_idx = _create_leaf();
+    for( int i=0; i<old_bucket.m_size; i++ ) {
+        Node& child = _nodes[ p_coords[i] >= split_value ? right_idx : left_idx ];
+        Bucket& bucket = _buckets[child.m_child[0]];
+        bucket.m_x[bucket.m_size] = old_bucket.m_x[i];
+        bucket.m_y[bucket.m_size] = old_bucket.m_y[i];
+        bucket.m_payload[bucket.m_size] = old_bucket.m_payload[i];
+        bucket.m_size++;
+        child.m_size++;
+        child.m_min[0] = std::min( child.m_min[0], old_bucket.m_x[i] );
+        child.m_min[1] = std::min( child.m_min[1], old_bucket.m_y[i] );
+        child.m_max[0] = std::max( child.m_max[0], old_bucket.m_x[i] );
+        child.m_max[1] = std::max( child.m_max[1], old_bucket.m_y[i] );
+    }
+
+    _free_buckets.push_back( bucket_idx );
+
+    Node& node = _nodes[node_idx];
+    node.m_split_dim = dim;
+    node.m_split_value = split_value;
+    node.m_child[0] = left_idx;
+    node.m_child[1] = right_idx;
+}
+
+void BucketKDTree::_rebuild( int node_idx ) {
+    _rebuild_points.clear();
+    _collect( node_idx );
+    _rebuilt_point_num += _rebuild_points.size();
+    _build( node_idx, &_rebuild_points[0], &_rebuild_points[0] + _rebuild_points.size() );
+}
+
+// moves the points of a subtree to _rebuild_points and frees everything below its root
+void BucketKDTree::_collect( int node_idx ) {
+    const Node& node = _nodes[node_idx];
+    if( node.m_split_dim < 0 ) {
+        const Bucket& bucket = _buckets[node.m_child[0]];
+        for( int i=0; i<bucket.m_size; i++ ) {
+            Point point;
+            point.m_pos[0] = bucket.m_x[i];
+            point.m_pos[1] = bucket.m_y[i];
+            point.m_payload = bucket.m_payload[i];
+            _rebuild_points.push_back( point );
+        }
+        _free_buckets.push_back( node.m_child[0] );
+        return;
+    }
+    for( int side=0; side<2; side++ ) {
+        int child_idx = _nodes[node_idx].m_child[side];
+        _collect( child_idx );
+        _free_nodes.push_back( child_idx );
+    }
+}
+
+class PointDimLess {
+public:
+    PointDimLess( int dim ) : m_dim( dim ) {}
+    bool operator()( const BucketKDTree::Point& a, const BucketKDTree::Point& b ) const { return a.m_pos[m_dim] < b.m_pos[m_dim]; }
+    int m_dim;
+};
+
+class PointBelowSplit {
+public:
+    PointBelowSplit( int dim, int32_t split_value ) : m_dim( dim ), m_split_value( split_value ) {}
+    bool operator()( const BucketKDTree::Point& point ) const { return point.m_pos[m_dim] < m_split_value; }
+    int m_dim;
+    int32_t m_split_value;
+};
+
+void BucketKDTree::_build( int node_idx, Point* p_begin, Point* p_end ) {
+    int32_t min[2] = { std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max() };
+    int32_t max[2] = { std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min() };
+    for( Point* p_point = p_begin; p_point != p_end; p_point++ ) {
+        for( int dim=0; dim<2; dim++ ) {
+            min[dim] = std::min( min[dim], p_point->m_pos[dim] );
+            max[dim] = std::max( max[dim], p_point->m_pos[dim] );
+        }
+    }
+    {
+        Node& node = _nodes[node_idx];
+        std::copy( min, min + 2, node.m_min );
+        std::copy( max, max + 2, node.m_max );
+        node.m_size = p_end - p_begin;
+    }
+
+    if( p_end - p_begin <= BUCKET_SIZE ) {
+        int bucket_idx = _create_bucket();
+        Bucket& bucket = _buckets[bucket_idx];
+        for( Point* p_point = p_begin; p_point != p_end; p_point++ ) {
+            bucket.m_x[bucket.m_size] = p_point->m_pos[0];
+            bucket.m_y[bucket.m_size] = p_point->m_pos[1];
+            bucket.m_payload[bucket.m_size] = p_point->m_payload;
+            bucket.m_size++;
+        }
+        Node& node = _nodes[node_idx];
+        node.m_split_dim = -1;
+        node.m_child[0] = bucket_idx;
+        node.m_child[1] = -1;
+        return;
+    }
+
+    // as in _split_leaf(), points on the split go right
+    int dim = ( max[0] - min[0] >= max[1] - min[1] ) ? 0 : 1;
+    Point* p_median = p_begin + ( p_end - p_begin ) / 2;
+    std::nth_element( p_begin, p_median, p_end, PointDimLess( dim ) );
+    int32_t split_value = p_median->m_pos[dim];
+    if( split_value == min[dim] ) {
+        split_value = max[dim];
+        for( Point* p_point = p_begin; p_point != p_end; p_point++ ) {
+            if( p_point->m_pos[dim] > min[dim] && p_point->m_pos[dim] < split_value ) {
+                split_value = p_point->m_pos[dim];
+            }
+        }
+    }
+    Point* p_split = std::partition( p_begin, p_end, PointBelowSplit( dim, split_value ) );
+
+    int left_idx = _create_node();
+    int right_idx = _create_node();
+    Node& node = _nodes[node_idx];
+    node.m_split_dim = dim;
+    node.m_split_value = split_value;
+    node.m_child[0] = left_idx;
+    node.m_child[1] = right_idx;
+    _build( left_idx, p_begin, p_split );
+    _build( right_idx, p_split, p_end );
+}
+
+double BucketKDTree::_get_box_dist_sq( const Node& node, const int32_t pos[2] ) const {
+    double dist_sq = 0.0;
+    for( int dim=0; dim<2; dim++ ) {
+        double delta = 0.0;
+        if( pos[dim] < node.m_min[dim] ) {
+            delta = (double)node.m_min[dim] - pos[dim];
+        }
+        else if( pos[dim] > node.m_max[dim] ) {
+            delta = (double)pos[dim] - node.m_max[dim];
+        }
+        dist_sq += delta * delta;
+    }
+    return dist_sq;
+}
+
+bool BucketKDTree::find_nearest( POS2D pos, uint32_t& payload ) const {
+    if( _size == 0 ) {
+        return false;
+    }
+    double best_dist_sq = std::numeric_limits<double>::max();
+    _find_nearest( 0, pos.d, best_dist_sq, payload );
+    return true;
+}
+
+void BucketKDTree::_find_nearest( int node_idx, const int32_t pos[2], double& best_dist_sq, uint32_t& payload ) const {
+    const Node& node = _nodes[node_idx];
+    if( node.m_split_dim < 0 ) {
+        const Bucket& bucket = _buckets[node.m_child[0]];
+        double dist_sq[BUCKET_SIZE];
+        for( int i=0; i<BUCKET_SIZE; i++ ) {
+            double dx = (double)( bucket.m_x[i] - pos[0] );
+            double dy = (double)( bucket.m_y[i] - pos[1] );
+            dist_sq[i] = dx*dx + dy*dy;
+        }
+        for( int i=0; i<bucket.m_size; i++ ) {
+            if( dist_sq[i] < best_dist_sq ) {
+                best_dist_sq = dist_sq[i];
+                payload = bucket.m_payload[i];
+            }
+        }
+        return;
+    }
+
+    int near_side = ( pos[node.m_split_dim] >= node.m_split_value ) ? 1 : 0;
+    int near_idx = node.m_child[near_side];
+    int far_idx = node.m_child[1 - near_side];
+    if( _get_box_dist_sq( _nodes[near_idx], pos ) < best_dist_sq ) {
+        _find_nearest( near_idx, pos, best_dist_sq, payload );
+    }
+    if( _get_box_dist_sq( _nodes[far_idx], pos ) < best_dist_sq ) {
+        _find_nearest( far_idx, pos, best_dist_sq, payload );
+    }
+}
+
+void BucketKDTree::find_within_radius( POS2D pos, double radius, std::vector<uint32_t>& payloads ) const {
+    if( _size == 0 ) {
+        return;
+    }
+    _find_within_radius( 0, pos.d, radius*radius, payloads );
+}
+
+void BucketKDTree::_find_within_radius( int node_idx, const int32_t pos[2], double radius_sq, std::vector<uint32_t>& payloads ) const {
+    const Node& node = _nodes[node_idx];
+    if( node.m_split_dim < 0 ) {
+        const Bucket& bucket = _buckets[node.m_child[0]];
+        double dist_sq[BUCKET_SIZE];
+        for( int i=0; i<BUCKET_SIZE; i++ ) {
+            double dx = (double)( bucket.m_x[i] - pos[0] );
+            double dy = (double)( bucket.m_y[i] - pos[1] );
+            dist_sq[i] = dx*dx + dy*dy;
+        }
+        for( int i=0; i<bucket.m_size; i++ ) {
+            if( dist_sq[i] <= radius_sq ) {
+                payloads.push_back( bucket.m_payload[i] );
+            }
+        }
+        return;
+    }
+
+    for( int side=0; side<2; side++ ) {
+        int child_idx = node.m_child[side];
+        if( _get_box_dist_sq( _nodes[child_idx], pos ) <= radius_sq ) {
+            _find_within_radius( child_idx, pos, radius_sq, payloads );
+        }
+    }
+}
+
+bool BucketKDTree::contains( POS2D pos ) const {
+    if( _size == 0 ) {
+        return false;
+    }
+    int node_idx = 0;
+    while( _nodes[node_idx].m_split_dim >= 0 ) {
+        const Node& node = _nodes[node_idx];
+        node_idx = node.m_child[ pos.d[node.m_split_dim] >= node.m_split_value ? 1 : 0 ];
+    }
+    const Bucket& bucket = _buckets[_nodes[node_idx].m_child[0]];
+    int match_num = 0;
+    for( int i=0; i<BUCKET_SIZE; i++ ) {
+        match_num += ( bucket.m_x[i] == pos.d[0] && bucket.m_y[i] == pos.d[1] ) ? 1 : 0;
+    }
+    return match_num > 0;
+}
+
+int BucketKDTree::get_depth() const {
+    if( _nodes.empty() ) {
+        return 0;
+    }
+    return _get_depth( 0 );
+}
+
+int BucketKDTree::_get_depth( int node_idx ) const {
+    const Node& node = _nodes[node_idx];
+    if( node.m_split_dim < 0 ) {
+        return 0;
+    }
+    return 1 + std::max( _get_depth( node.m_child[0] ), _get_depth( node.m_child[1] ) );
+}
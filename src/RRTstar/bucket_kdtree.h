@@ -0,0 +1,105 @@
+#ifndef BUCKET_KDTREE_H
+#define BUCKET_KDTREE_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "KDTree2D.h"
+
+/*
+ * 2D index of integer points, each with a 32-bit payload. Inner nodes
+ * split at the median of the leaf they came from and keep the bounding box
+ * of their points; leaves are buckets of up to BUCKET_SIZE points in
+ * structure-of-arrays form. The scans of a bucket always run over all
+ * BUCKET_SIZE slots, unused ones hold a far away sentinel, so the
+ * distance loops have a fixed trip count and are vectorised by the
+ * compiler. Queries are const and may run concurrently, insert() may not.
+ *
+ * The tree stays balanced whatever the insertion order: every inner node
+ * counts its points, and when one side of a node holds more than
+ * BALANCE_ALPHA of them the subtree is rebuilt with median splits, as in
+ * a scapegoat tree. That bounds the depth by log(n/BUCKET_SIZE) base
+ * 1/BALANCE_ALPHA at an amortised O(log n) cost per insert.
+ */
+class BucketKDTree {
+
+public:
+    static const int BUCKET_SIZE = 32;
+    static const double BALANCE_ALPHA;
+
+    // a point as moved around by rebuilds
+    class Point {
+    public:
+        int32_t  m_pos[2];
+        uint32_t m_payload;
+    };
+
+    BucketKDTree();
+
+    void clear();
+    unsigned int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    // coordinates must be below 2^28 in magnitude, false if pos is
+    // already stored BUCKET_SIZE times
+    bool insert( POS2D pos, uint32_t payload );
+    // room for point_num points, so that insert() does not allocate before
+    void reserve( unsigned int point_num );
+
+    // false if the tree is empty
+    bool find_nearest( POS2D pos, uint32_t& payload ) const;
+    // appends the payloads of the points at most radius away from pos
+    void find_within_radius( POS2D pos, double radius, std::vector<uint32_t>& payloads ) const;
+    bool contains( POS2D pos ) const;
+
+    // of the deepest leaf, the root is at depth 0
+    int get_depth() const;
+    long get_rebuilt_point_num() const { return _rebuilt_point_num; }
+
+private:
+    class Node {
+    public:
+        int32_t m_min[2];
+        int32_t m_max[2];
+        // -1 for a leaf, whose bucket is m_child[0]
+        int32_t m_split_dim;
+        int32_t m_split_value;
+        int32_t m_child[2];
+        uint32_t m_size;
+    };
+
+
+    class Bucket {
+    public:
+        int32_t  m_x[BUCKET_SIZE];
+        int32_t  m_y[BUCKET_SIZE];
+        uint32_t m_payload[BUCKET_SIZE];
+        int32_t  m_size;
+    };
+
+    int _create_node();
+    int _create_bucket();
+    int _create_leaf();
+    void _split_leaf( int node_idx );
+    void _rebuild( int node_idx );
+    void _collect( int node_idx );
+    void _build( int node_idx, Point* p_begin, Point* p_end );
+    int _get_depth( int node_idx ) const;
+    double _get_box_dist_sq( const Node& node, const int32_t pos[2] ) const;
+
+    void _find_nearest( int node_idx, const int32_t pos[2], double& best_dist_sq, uint32_t& payload ) const;
+    void _find_within_radius( int node_idx, const int32_t pos[2], double radius_sq, std::vector<uint32_t>& payloads ) const;
+
+    std::vector<Node>   _nodes;
+    std::vector<Bucket> _buckets;
+    // of subtrees being rebuilt, reused by the nodes and buckets created next
+    std::vector<int> _free_nodes;
+    std::vector<int> _free_buckets;
+    // scratch buffers of insert() and _rebuild()
+    std::vector<int> _insert_path;
+    std::vector<Point> _rebuild_points;
+    unsigned int _size;
+    long _rebuilt_point_num;
+};
+
+#endif // BUCKET_KDTREE_H
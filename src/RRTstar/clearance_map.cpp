@@ -0,0 +1,163 @@
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "clearance_map.h"
+
+#define CLEARANCE_INF 1e20
+
+ClearanceMap::ClearanceMap() {
+    _width = 0;
+    _height = 0;
+}
+
+void ClearanceMap::clear() {
+    _width = 0;
+    _height = 0;
+    std::vector<uint8_t>().swap( _clearance );
+}
+
+void ClearanceMap::_distance_transform_1d( const double* p_f, int n, double* p_d, int* p_v, double* p_z ) {
+    // lower envelope of parabolas (Felzenszwalb and Huttenlocher)
+    int k = 0;
+    p_v[0] = 0;
+    p_z[0] = -CLEARANCE_INF;
+    p_z[1] = CLEARANCE_INF;
+    for( int q=1; q<n; q++ ) {
+        double s = ( ( p_f[q] + (double)q*q ) - ( p_f[p_v[k]] + (double)p_v[k]*p_v[k] ) ) / ( 2.0*q - 2.0*p_v[k] );
+        while( s <= p_z[k] ) {
+            k--;
+            s = ( ( p_f[q] + (double)q*q ) - ( p_f[p_v[k]] + (double)p_v[k]*p_v[k] ) ) / ( 2.0*q - 2.0*p_v[k] );
+        }
+        k++;
+        p_v[k] = q;
+        p_z[k] = s;
+        p_z[k+1] = CLEARANCE_INF;
+    }
+    k = 0;
+    for( int q=0; q<n; q++ ) {
+        while( p_z[k+1] < q ) {
+            k++;
+        }
+        p_d[q] = (double)( q - p_v[k] ) * ( q - p_v[k] ) + p_f[p_v[k]];
+    }
+}
+
+void ClearanceMap::build( const OccupancyBitmap& obstacles ) {
+    int width = obstacles.get_width();
+    int height = obstacles.get_height();
+    _width = width;
+    _height = height;
+    _clearance.assign( (size_t)width * height, 0 );
+
+    int n = std::max( width, height );
+    std::vector<double> f( n ), d( n ), z( n + 1 );
+    std::vector<int> v( n );
+
+    // distance along each column, saturated and kept in _clearance itself.
+    // Saturating at MAX_CLEARANCE only changes results of MAX_CLEARANCE^2
+    // and more, and those saturate anyway
+    for( int i=0; i<width; i++ ) {
+        for( int j=0; j<height; j++ ) {
+            f[j] = obstacles.is_occupied_in_map( i, j ) ? 0.0 : CLEARANCE_INF;
+        }
+        _distance_transform_1d( &f[0], height, &d[0], &v[0], &z[0] );
+        for( int j=0; j<height; j++ ) {
+            double dist = sqrt( d[j] );
+            _clearance[(size_t)j * width + i] = ( dist >= MAX_CLEARANCE ) ? MAX_CLEARANCE : (uint8_t)dist;
+        }
+    }
+
+    // then along each row
+    for( int j=0; j<height; j++ ) {
+        uint8_t* p_row = &_clearance[(size_t)j * width];
+        for( int i=0; i<width; i++ ) {
+            f[i] = (double)p_row[i] * p_row[i];
+        }
+        _distance_transform_1d( &f[0], width, &d[0], &v[0], &z[0] );
+        for( int i=0; i<width; i++ ) {
+            double dist = floor( sqrt( d[i] ) );
+            p_row[i] = ( dist >= MAX_CLEARANCE ) ? MAX_CLEARANCE : (uint8_t)dist;
+        }
+    }
+}
+
+bool ClearanceMap::covers_segment( POS2D pos_a, POS2D pos_b ) const {
+    int x1 = pos_a[0];
+    int y1 = pos_a[1];
+    int x2 = pos_b[0];
+    int y2 = pos_b[1];
+
+    // every cell of the Bresenham line lies within half a cell of the
+    // segment, so it is free if either endpoint clears length + 0.5
+    double reach = sqrt( (double)( x2 - x1 ) * ( x2 - x1 ) + (double)( y2 - y1 ) * ( y2 - y1 ) ) + 0.5;
+    if( x1 >= 0 && x1 < _width && y1 >= 0 && y1 < _height && get_clearance( x1, y1 ) > reach ) {
+        return true;
+    }
+    if( x2 >= 0 && x2 < _width && y2 >= 0 && y2 < _height && get_clearance( x2, y2 ) > reach ) {
+        return true;
+    }
+    return false;
+}
+
+bool ClearanceMap::is_segment_free( POS2D pos_a, POS2D pos_b ) const {
+    if ( pos_a == pos_b || covers_segment( pos_a, pos_b ) ) {
+        return true;
+    }
+
+    int x1 = pos_a[0];
+    int y1 = pos_a[1];
+    int x2 = pos_b[0];
+    int y2 = pos_b[1];
+
+    // otherwise walk the same cells as RRTstar::_is_obstacle_free(),
+    // skipping the ones that the clearance of the current cell covers
+    const bool steep = ( abs(y2 - y1) > abs(x2 - x1) );
+    if ( steep ) {
+        std::swap( x1, y1 );
+        std::swap( x2, y2 );
+    }
+    if ( x1 > x2 ) {
+        std::swap( x1, x2 );
+        std::swap( y1, y2 );
+    }
+
+    const long dx = x2 - x1;
+    const long dy = abs( y2 - y1 );
+    const int ystep = (y1 < y2) ? 1 : -1;
+    // distance covered by one step along the major axis
+    const double step_len = sqrt( 1.0 + (double)( dy * dy ) / (double)( dx * dx ) );
+
+    long error = dx;
+    int y = y1;
+    int x = x1;
+    const int maxX = x2;
+
+    while( x < maxX ) {
+        int cell_x = steep ? y : x;
+        int cell_y = steep ? x : y;
+        long steps = 1;
+        if( cell_x >= 0 && cell_x < _width && cell_y >= 0 && cell_y < _height ) {
+            uint8_t clearance = get_clearance( cell_x, cell_y );
+            if( clearance == 0 ) {
+                return false;
+            }
+            // two line cells k steps apart are at most k * step_len + 1 apart
+            double reachable = ( clearance - 1.0 ) / step_len;
+            long skip = (long)reachable;
+            if( skip > 0 && skip == reachable ) {
+                skip--;
+            }
+            steps += skip;
+        }
+
+        x += steps;
+        error -= steps * 2 * dy;
+        if( error < 0 ) {
+            long wraps = ( -error + 2 * dx - 1 ) / ( 2 * dx );
+            y += ystep * wraps;
+            error += wraps * 2 * dx;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef CLEARANCE_MAP_H
+#define CLEARANCE_MAP_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "KDTree2D.h"
+#include "occupancy_bitmap.h"
+
+/*
+ * Exact Euclidean distance transform of the obstacle cells of a map.
+ * Each cell stores the distance from its center to the nearest obstacle
+ * cell center, rounded down and saturated to 8 bits, so 0 marks an
+ * obstacle and any cell closer than the stored value is known to be free.
+ */
+class ClearanceMap {
+
+public:
+    static const uint8_t MAX_CLEARANCE = 0xFF;
+
+    ClearanceMap();
+
+    void build( const OccupancyBitmap& obstacles );
+    void clear();
+
+    bool empty() const { return _clearance.empty(); }
+    uint8_t get_clearance( int x, int y ) const { return _clearance[(size_t)y * _width + x]; }
+
+    bool covers_segment( POS2D pos_a, POS2D pos_b ) const;
+    bool is_segment_free( POS2D pos_a, POS2D pos_b ) const;
+
+private:
+    static void _distance_transform_1d( const double* p_f, int n, double* p_d, int* p_v, double* p_z );
+
+    int _width;
+    int _height;
+    std::vector<uint8_t> _clearance;
+};
+
+#endif // CLEARANCE_MAP_H
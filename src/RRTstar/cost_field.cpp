@@ -0,0 +1,12 @@
+#include "cost_field.h"
+
+double calc_field_cost( POS2D pos_a, POS2D pos_b, GridView<const double> distribution, void* tree ) {
+    if( distribution.empty() ) {
+        return 0.0;
+    }
+    return integrate_cost_field( pos_a, pos_b, distribution );
+}
+
+double calc_euclidean_cost( POS2D pos_a, POS2D pos_b, GridView<const double> distribution, void* tree ) {
+    return pos_a.distance_to( pos_b );
+}
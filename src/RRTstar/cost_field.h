@@ -0,0 +1,71 @@
+#ifndef COST_FIELD_H
+#define COST_FIELD_H
+
+#include "KDTree2D.h"
+#include "segment_walk.h"
+#include "occupancy_bitmap.h"
+#include "grid.h"
+
+class FieldSum {
+public:
+    FieldSum( GridView<const double> field ) : m_field( field ), m_sum( 0.0 ) {}
+
+    bool operator()( int x, int y ) {
+        m_sum += m_field( x, y );
+        return true;
+    }
+
+    GridView<const double> m_field;
+    double   m_sum;
+};
+
+class ObstacleFreeFieldSum {
+public:
+    ObstacleFreeFieldSum( GridView<const double> field, const OccupancyBitmap& obstacles )
+        : m_field( field ), m_obstacles( obstacles ), m_sum( 0.0 ) {}
+
+    bool operator()( int x, int y ) {
+        if( m_obstacles.is_occupied_in_map( x, y ) ) {
+            return false;
+        }
+        m_sum += m_field( x, y );
+        return true;
+    }
+
+    GridView<const double> m_field;
+    const OccupancyBitmap& m_obstacles;
+    double   m_sum;
+};
+
+// inline so that the cost policies compile the walk into the planner loops
+inline double integrate_cost_field( POS2D pos_a, POS2D pos_b, GridView<const double> field ) {
+    FieldSum sum( field );
+    walk_segment( pos_a, pos_b, field.get_width(), field.get_height(), sum );
+    return sum.m_sum;
+}
+
+/*
+ * Fused edge kernel: one walk that stops at the first obstacle cell and
+ * otherwise sums the cost field over the same cells.
+ */
+inline bool trace_cost_field( POS2D pos_a, POS2D pos_b, GridView<const double> field, const OccupancyBitmap& obstacles, double& cost ) {
+    ObstacleFreeFieldSum sum( field, obstacles );
+    if( false == walk_segment( pos_a, pos_b, obstacles.get_width(), obstacles.get_height(), sum ) ) {
+        cost = 0.0;
+        return false;
+    }
+    cost = sum.m_sum;
+    return true;
+}
+
+/*
+ * Cost function integrating the cost distribution along the edge. A
+ * planner initialised with this function checks and costs each near edge
+ * with trace_cost_field().
+ */
+double calc_field_cost( POS2D pos_a, POS2D pos_b, GridView<const double> distribution, void* tree );
+
+// cost function of the Euclidean edge length, the distribution is ignored
+double calc_euclidean_cost( POS2D pos_a, POS2D pos_b, GridView<const double> distribution, void* tree );
+
+#endif // COST_FIELD_H
@@ -0,0 +1,112 @@
+#ifndef COST_POLICY_H
+#define COST_POLICY_H
+
+#include <cmath>
+#include <cstddef>
+
+#include "KDTree2D.h"
+#include "grid.h"
+#include "cost_field.h"
+#include "paged_grid.h"
+
+typedef double (*COST_FUNC_PTR)(POS2D, POS2D, GridView<const double>, void*);
+
+/*
+ * Edge cost policies of RRTstarT. init() binds the policy to the cost
+ * distribution and the planner, cost() returns the cost of the edge from
+ * pos_a to pos_b and integrates_field() tells whether that cost is the
+ * integral of the distribution along the edge, in which case the planner
+ * fuses it with the obstacle check.
+ */
+class EuclideanCost {
+
+public:
+    void bind( GridView<const double> distribution, void* p_tree ) {}
+
+    double cost( const POS2D& pos_a, const POS2D& pos_b ) const {
+        double delta_x = pos_a.d[0] - pos_b.d[0];
+        double delta_y = pos_a.d[1] - pos_b.d[1];
+        return sqrt( delta_x*delta_x + delta_y*delta_y );
+    }
+
+    bool integrates_field() const { return false; }
+};
+
+class FieldIntegralCost {
+
+public:
+    void bind( GridView<const double> distribution, void* p_tree ) { m_distribution = distribution; }
+
+    double cost( const POS2D& pos_a, const POS2D& pos_b ) const {
+        if( m_distribution.empty() ) {
+            return 0.0;
+        }
+        return integrate_cost_field( pos_a, pos_b, m_distribution );
+    }
+
+    bool integrates_field() const { return false == m_distribution.empty(); }
+
+private:
+    GridView<const double> m_distribution;
+};
+
+/*
+ * FieldIntegralCost over a cost field paged in from a tiled grid file,
+ * set with set_field() instead of being bound at init. The field is read
+ * on the planner thread only and never fused with the obstacle check.
+ */
+class PagedFieldIntegralCost {
+
+public:
+    PagedFieldIntegralCost() : mp_field( NULL ) {}
+
+    void set_field( PagedGrid<double>* p_field ) { mp_field = p_field; }
+    PagedGrid<double>* get_field() const { return mp_field; }
+
+    void bind( GridView<const double> distribution, void* p_tree ) {}
+
+    double cost( const POS2D& pos_a, const POS2D& pos_b ) const {
+        if( NULL == mp_field ) {
+            return 0.0;
+        }
+        return integrate_paged_field( pos_a, pos_b, *mp_field );
+    }
+
+    bool integrates_field() const { return false; }
+
+private:
+    PagedGrid<double>* mp_field;
+};
+
+/*
+ * Runtime adapter for a COST_FUNC_PTR, this is the policy of the plain
+ * RRTstar. calc_field_cost is recognised so that it still gets the fused
+ * edge evaluation. Until a function is set, edges cost their Euclidean
+ * length as with calc_euclidean_cost.
+ */
+class FuncPtrCost {
+
+public:
+    FuncPtrCost() : mp_func( calc_euclidean_cost ), mp_tree( NULL ) {}
+
+    void set_func( COST_FUNC_PTR p_func ) { mp_func = p_func; }
+    COST_FUNC_PTR get_func() const { return mp_func; }
+
+    void bind( GridView<const double> distribution, void* p_tree ) {
+        m_distribution = distribution;
+        mp_tree = p_tree;
+    }
+
+    double cost( const POS2D& pos_a, const POS2D& pos_b ) const {
+        return mp_func( pos_a, pos_b, m_distribution, mp_tree );
+    }
+
+    bool integrates_field() const { return mp_func == calc_field_cost && false == m_distribution.empty(); }
+
+private:
+    COST_FUNC_PTR mp_func;
+    GridView<const double> m_distribution;
+    void*         mp_tree;
+};
+
+#endif // COST_POLICY_H
@@ -0,0 +1,107 @@
+#ifndef EXTEND_STATS_H
+#define EXTEND_STATS_H
+
+#include <cstring>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/*
+ * Why a sample did or did not become a node, see _prepare_extension().
+ */
+enum ExtendRejection {
+    EXTEND_ACCEPTED = 0,
+    REJECT_ON_NEAREST,   // the sample is the nearest node itself
+    REJECT_CONTAINED,    // the steered position is already a node
+    REJECT_IN_OBSTACLE,  // the steered position is in an obstacle
+    REJECT_COLLISION,    // the segment from the nearest node is blocked
+    REJECTION_NUM
+};
+
+enum ExtendPhase {
+    PHASE_EXTENSION = 0, // nearest node, steering and checks on the planner thread
+    PHASE_PREPARE_BATCH, // the speculative phase of extend_n(), workers included
+    PHASE_NEAR,          // _find_near()
+    PHASE_INSERT,        // node creation and the index insert
+    PHASE_ATTACH,        // parent selection
+    PHASE_REWIRE,        // rewiring and cost propagation
+    PHASE_NUM
+};
+
+/*
+ * Counters of extend() and extend_n(), updated only when the library and
+ * the code including rrtstar.h are compiled with RRTSTAR_STATS, phase
+ * timers (in cycles) only with RRTSTAR_STATS_TIMERS as well. Without the
+ * flags the updates compile to nothing and the stats stay zero; the
+ * layout is the same either way. Everything is counted on the planner
+ * thread, results of the worker threads are counted when committed.
+ */
+class ExtendStats {
+
+public:
+#if defined(RRTSTAR_STATS) || defined(RRTSTAR_STATS_TIMERS)
+    static const bool ENABLED = true;
+#else
+    static const bool ENABLED = false;
+#endif
+#ifdef RRTSTAR_STATS_TIMERS
+    static const bool TIMERS_ENABLED = true;
+#else
+    static const bool TIMERS_ENABLED = false;
+#endif
+
+    ExtendStats() { reset(); }
+    void reset() { memset( this, 0, sizeof(*this) ); }
+
+    long m_sample_num;
+    // per ExtendRejection, EXTEND_ACCEPTED counts the inserted nodes
+    long m_extension_num[REJECTION_NUM];
+    // batch candidates checked again because the tree grew closer to their sample
+    long m_stale_candidate_num;
+    long m_near_query_num;
+    long m_near_node_num;
+    long m_max_near_node_num;
+    long m_edge_evaluation_num;
+    long m_rewire_num;
+    long m_propagation_num;
+
+    uint64_t m_phase_cycles[PHASE_NUM];
+};
+
+inline uint64_t read_cycle_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+// adds the cycles of its scope to one phase
+class PhaseTimer {
+public:
+    PhaseTimer( ExtendStats& stats, ExtendPhase phase ) : m_stats( stats ), m_phase( phase ), m_begin( read_cycle_counter() ) {}
+    ~PhaseTimer() { m_stats.m_phase_cycles[m_phase] += read_cycle_counter() - m_begin; }
+
+    ExtendStats& m_stats;
+    ExtendPhase  m_phase;
+    uint64_t     m_begin;
+};
+
+#if defined(RRTSTAR_STATS) || defined(RRTSTAR_STATS_TIMERS)
+#define RRTSTAR_STATS_ADD( counter, value ) ( _stats.counter += (value) )
+#define RRTSTAR_STATS_MAX( counter, value ) ( (long)(value) > _stats.counter ? (void)( _stats.counter = (value) ) : (void)0 )
+#else
+#define RRTSTAR_STATS_ADD( counter, value ) ((void)0)
+#define RRTSTAR_STATS_MAX( counter, value ) ((void)0)
+#endif
+
+#ifdef RRTSTAR_STATS_TIMERS
+#define RRTSTAR_STATS_TIMER( phase ) PhaseTimer phase_timer_##phase( _stats, phase )
+#else
+#define RRTSTAR_STATS_TIMER( phase ) ((void)0)
+#endif
+
+#endif // EXTEND_STATS_H
@@ -0,0 +1,111 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+template <class T> class Grid;
+
+/*
+ * Non-owning view of a row-major grid, cell (x, y) lives at
+ * data[y * stride + x]. T may be const for read-only views. A view is
+ * cheap to copy and is how maps and cost fields are passed around.
+ */
+template <class T>
+class GridView {
+
+public:
+    GridView() : _p_data( NULL ), _width( 0 ), _height( 0 ), _stride( 0 ) {}
+    GridView( T* p_data, int width, int height, int stride )
+        : _p_data( p_data ), _width( width ), _height( height ), _stride( stride ) {}
+    GridView( T* p_data, int width, int height )
+        : _p_data( p_data ), _width( width ), _height( height ), _stride( width ) {}
+
+    // views of non-const cells or of an owning grid convert implicitly
+    template <class U>
+    GridView( const GridView<U>& other )
+        : _p_data( other.get_data() ), _width( other.get_width() ), _height( other.get_height() ), _stride( other.get_stride() ) {}
+    template <class U>
+    GridView( Grid<U>& grid )
+        : _p_data( grid.get_data() ), _width( grid.get_width() ), _height( grid.get_height() ), _stride( grid.get_width() ) {}
+    template <class U>
+    GridView( const Grid<U>& grid )
+        : _p_data( grid.get_data() ), _width( grid.get_width() ), _height( grid.get_height() ), _stride( grid.get_width() ) {}
+
+    T& operator()( int x, int y ) const { return _p_data[(size_t)y * _stride + x]; }
+    T* get_row( int y ) const { return _p_data + (size_t)y * _stride; }
+
+    // window of the same cells, e.g. a tile, sharing this view's stride
+    GridView<T> sub_view( int x, int y, int width, int height ) const {
+        return GridView<T>( _p_data + (size_t)y * _stride + x, width, height, _stride );
+    }
+
+    bool empty() const { return _p_data == NULL || _width == 0 || _height == 0; }
+    bool contains( int x, int y ) const { return x >= 0 && y >= 0 && x < _width && y < _height; }
+
+    T* get_data() const { return _p_data; }
+    int get_width() const { return _width; }
+    int get_height() const { return _height; }
+    int get_stride() const { return _stride; }
+
+private:
+    T*  _p_data;
+    int _width;
+    int _height;
+    int _stride;
+};
+
+/*
+ * Owning row-major grid, all cells in one contiguous allocation.
+ */
+template <class T>
+class Grid {
+
+public:
+    Grid() : _width( 0 ), _height( 0 ) {}
+    Grid( int width, int height, const T& value = T() ) : _width( 0 ), _height( 0 ) { resize( width, height, value ); }
+
+    void resize( int width, int height, const T& value = T() ) {
+        _width = width;
+        _height = height;
+        _cells.assign( (size_t)width * height, value );
+    }
+
+    void assign( GridView<const T> other ) {
+        resize( other.get_width(), other.get_height() );
+        for( int y=0; y<_height; y++ ) {
+            const T* p_src = other.get_row( y );
+            std::copy( p_src, p_src + _width, get_row( y ) );
+        }
+    }
+
+    void clear() {
+        _width = 0;
+        _height = 0;
+        std::vector<T>().swap( _cells );
+    }
+
+    T& operator()( int x, int y ) { return _cells[(size_t)y * _width + x]; }
+    const T& operator()( int x, int y ) const { return _cells[(size_t)y * _width + x]; }
+    T* get_row( int y ) { return &_cells[(size_t)y * _width]; }
+    const T* get_row( int y ) const { return &_cells[(size_t)y * _width]; }
+
+    GridView<T> view() { return GridView<T>( *this ); }
+    GridView<const T> view() const { return GridView<const T>( *this ); }
+
+    bool empty() const { return _cells.empty(); }
+    bool contains( int x, int y ) const { return x >= 0 && y >= 0 && x < _width && y < _height; }
+
+    T* get_data() { return _cells.empty() ? NULL : &_cells[0]; }
+    const T* get_data() const { return _cells.empty() ? NULL : &_cells[0]; }
+    int get_width() const { return _width; }
+    int get_height() const { return _height; }
+
+private:
+    int _width;
+    int _height;
+    std::vector<T> _cells;
+};
+
+#endif // GRID_H
@@ -0,0 +1,198 @@
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <limits>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "grid_file.h"
+
+size_t get_grid_cell_size( uint32_t cell_type ) {
+    switch( cell_type ) {
+    case GRID_CELL_UINT8:
+        return sizeof(uint8_t);
+    case GRID_CELL_FLOAT64:
+        return sizeof(double);
+    }
+    return 0;
+}
+
+// false if a * b does not fit in 64 bits
+static bool multiply_size( uint64_t a, uint64_t b, uint64_t& product ) {
+    if( a != 0 && b > std::numeric_limits<uint64_t>::max() / a ) {
+        return false;
+    }
+    product = a * b;
+    return true;
+}
+
+bool is_grid_file_header_valid( const GridFileHeader& header, uint64_t file_size ) {
+    size_t size = get_grid_cell_size( header.m_cell_type );
+    if( memcmp( header.m_magic, "RRTG", 4 ) != 0 || header.m_version != GridFileHeader::VERSION || size == 0 ) {
+        return false;
+    }
+    if( header.m_data_offset % size != 0 || header.m_data_offset > file_size ) {
+        return false;
+    }
+    // the grids are indexed with int
+    if( header.m_width > INT_MAX || header.m_height > INT_MAX || header.m_tile_size > INT_MAX ) {
+        return false;
+    }
+    uint64_t cell_num = (uint64_t)header.m_width * header.m_height;
+    if( header.m_tile_size > 0 ) {
+        uint64_t tile_size = header.m_tile_size;
+        if( ( tile_size & ( tile_size - 1 ) ) != 0 ) {
+            return false;
+        }
+        uint64_t tile_x_num = ( header.m_width + tile_size - 1 ) / tile_size;
+        uint64_t tile_y_num = ( header.m_height + tile_size - 1 ) / tile_size;
+        if( false == multiply_size( tile_x_num, tile_y_num, cell_num )
+            || false == multiply_size( cell_num, tile_size * tile_size, cell_num ) ) {
+            return false;
+        }
+    }
+    uint64_t data_size = 0;
+    if( false == multiply_size( cell_num, size, data_size ) ) {
+        return false;
+    }
+    return data_size <= file_size - header.m_data_offset;
+}
+
+template <class T>
+static bool write_grid_file( const std::string& filename, GridView<const T> grid, int tile_size, int threshold ) {
+    if( grid.empty() || ( tile_size & ( tile_size - 1 ) ) != 0 ) {
+        return false;
+    }
+    std::ofstream file( filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+    if( false == file.is_open() ) {
+        return false;
+    }
+
+    char header_block[GridFileHeader::DATA_OFFSET];
+    memset( header_block, 0, sizeof(header_block) );
+    GridFileHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.m_magic, "RRTG", 4 );
+    header.m_version = GridFileHeader::VERSION;
+    header.m_cell_type = GridCellTraits<T>::CELL_TYPE;
+    header.m_width = grid.get_width();
+    header.m_height = grid.get_height();
+    header.m_threshold = threshold;
+    header.m_data_offset = GridFileHeader::DATA_OFFSET;
+    header.m_tile_size = tile_size;
+    memcpy( header_block, &header, sizeof(header) );
+    file.write( header_block, sizeof(header_block) );
+
+    if( tile_size == 0 ) {
+        for( int j=0; j<grid.get_height(); j++ ) {
+            file.write( reinterpret_cast<const char*>( grid.get_row( j ) ), sizeof(T) * grid.get_width() );
+        }
+        return file.good();
+    }
+
+    // tile rows of the grid are read once, edge tiles are padded with zeros
+    std::vector<T> tile_row( tile_size, T() );
+    for( int tile_y=0; tile_y<grid.get_height(); tile_y+=tile_size ) {
+        for( int tile_x=0; tile_x<grid.get_width(); tile_x+=tile_size ) {
+            int cell_x_num = std::min( tile_size, grid.get_width() - tile_x );
+            for( int j=tile_y; j<tile_y+tile_size; j++ ) {
+                std::fill( tile_row.begin(), tile_row.end(), T() );
+                if( j < grid.get_height() ) {
+                    const T* p_src = grid.get_row( j ) + tile_x;
+                    std::copy( p_src, p_src + cell_x_num, tile_row.begin() );
+                }
+                file.write( reinterpret_cast<const char*>( &tile_row[0] ), sizeof(T) * tile_size );
+            }
+        }
+    }
+    return file.good();
+}
+
+bool save_grid_file( const std::string& filename, GridView<const uint8_t> grid, int threshold ) {
+    return write_grid_file( filename, grid, 0, threshold );
+}
+
+bool save_grid_file( const std::string& filename, GridView<const double> grid ) {
+    return write_grid_file( filename, grid, 0, -1 );
+}
+
+bool save_tiled_grid_file( const std::string& filename, GridView<const uint8_t> grid, int tile_size, int threshold ) {
+    return tile_size > 0 && write_grid_file( filename, grid, tile_size, threshold );
+}
+
+bool save_tiled_grid_file( const std::string& filename, GridView<const double> grid, int tile_size ) {
+    return tile_size > 0 && write_grid_file( filename, grid, tile_size, -1 );
+}
+
+GridFile::GridFile() {
+    memset( &_header, 0, sizeof(_header) );
+    _p_mapping = NULL;
+    _mapping_size = 0;
+}
+
+GridFile::~GridFile() {
+    close();
+}
+
+bool GridFile::open( const std::string& filename ) {
+    close();
+
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat file_stat;
+    if( fstat( fd, &file_stat ) != 0 || (size_t)file_stat.st_size < sizeof(GridFileHeader) ) {
+        ::close( fd );
+        return false;
+    }
+    size_t file_size = file_stat.st_size;
+    void* p_mapping = mmap( NULL, file_size, PROT_READ, MAP_SHARED, fd, 0 );
+    // the mapping stays valid without the descriptor
+    ::close( fd );
+    if( p_mapping == MAP_FAILED ) {
+        return false;
+    }
+
+    GridFileHeader header;
+    memcpy( &header, p_mapping, sizeof(header) );
+    if( false == is_grid_file_header_valid( header, file_size ) || header.m_tile_size != 0 ) {
+        munmap( p_mapping, file_size );
+        return false;
+    }
+
+    _header = header;
+    _p_mapping = p_mapping;
+    _mapping_size = file_size;
+    return true;
+}
+
+void GridFile::close() {
+    if( _p_mapping ) {
+        munmap( _p_mapping, _mapping_size );
+        _p_mapping = NULL;
+        _mapping_size = 0;
+    }
+    memset( &_header, 0, sizeof(_header) );
+}
+
+GridView<const uint8_t> GridFile::get_uint8_grid() const {
+    if( _p_mapping == NULL || _header.m_cell_type != GRID_CELL_UINT8 ) {
+        return GridView<const uint8_t>();
+    }
+    const uint8_t* p_cells = static_cast<const uint8_t*>( _p_mapping ) + _header.m_data_offset;
+    return GridView<const uint8_t>( p_cells, _header.m_width, _header.m_height );
+}
+
+GridView<const double> GridFile::get_float64_grid() const {
+    if( _p_mapping == NULL || _header.m_cell_type != GRID_CELL_FLOAT64 ) {
+        return GridView<const double>();
+    }
+    const uint8_t* p_cells = static_cast<const uint8_t*>( _p_mapping ) + _header.m_data_offset;
+    return GridView<const double>( reinterpret_cast<const double*>( p_cells ), _header.m_width, _header.m_height );
+}
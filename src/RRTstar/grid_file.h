@@ -0,0 +1,91 @@
+#ifndef GRID_FILE_H
+#define GRID_FILE_H
+
+#include <string>
+#include <stdint.h>
+
+#include "grid.h"
+
+enum GridCellType {
+    GRID_CELL_UINT8 = 1,
+    GRID_CELL_FLOAT64 = 2
+};
+
+/*
+ * Binary grid file: a 64 byte header followed by the cells in native
+ * byte order. A file written on a machine of the other byte order is
+ * rejected by its version field. The cells of a flat file are row-major,
+ * those of a tiled file are stored tile after tile, in row-major tile
+ * order, each tile row-major and padded to the full tile size.
+ */
+class GridFileHeader {
+
+public:
+    static const uint32_t VERSION = 1;
+    static const uint64_t DATA_OFFSET = 64;
+
+    char     m_magic[4];      // "RRTG"
+    uint32_t m_version;
+    uint32_t m_cell_type;     // GridCellType
+    uint32_t m_width;
+    uint32_t m_height;
+    int32_t  m_threshold;     // obstacle threshold of a uint8 map, -1 if none
+    uint64_t m_data_offset;   // from the start of the file
+    uint32_t m_tile_size;     // 0 for a flat file, else the power of two side of a tile
+};
+
+template <class T> class GridCellTraits;
+
+template <> class GridCellTraits<uint8_t> {
+public:
+    static const GridCellType CELL_TYPE = GRID_CELL_UINT8;
+};
+
+template <> class GridCellTraits<double> {
+public:
+    static const GridCellType CELL_TYPE = GRID_CELL_FLOAT64;
+};
+
+size_t get_grid_cell_size( uint32_t cell_type );
+// checks the header against the size of the file it was read from
+bool is_grid_file_header_valid( const GridFileHeader& header, uint64_t file_size );
+
+bool save_grid_file( const std::string& filename, GridView<const uint8_t> grid, int threshold );
+bool save_grid_file( const std::string& filename, GridView<const double> grid );
+bool save_tiled_grid_file( const std::string& filename, GridView<const uint8_t> grid, int tile_size, int threshold );
+bool save_tiled_grid_file( const std::string& filename, GridView<const double> grid, int tile_size );
+
+/*
+ * A flat grid file mapped read-only, its cells are used in place through
+ * the views below for as long as the GridFile stays open. Tiled files are
+ * read through a PagedGrid instead.
+ */
+class GridFile {
+
+public:
+    GridFile();
+    ~GridFile();
+
+    bool open( const std::string& filename );
+    void close();
+    bool is_open() const { return _p_mapping != NULL; }
+
+    GridCellType get_cell_type() const { return (GridCellType)_header.m_cell_type; }
+    int get_width() const { return _header.m_width; }
+    int get_height() const { return _header.m_height; }
+    int get_threshold() const { return _header.m_threshold; }
+
+    // empty unless the file holds cells of that type
+    GridView<const uint8_t> get_uint8_grid() const;
+    GridView<const double> get_float64_grid() const;
+
+private:
+    GridFile( const GridFile& other );
+    GridFile& operator=( const GridFile& other );
+
+    GridFileHeader _header;
+    void*  _p_mapping;
+    size_t _mapping_size;
+};
+
+#endif // GRID_FILE_H
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "grid_hash_index.h"
+
+// points are scanned in chunks whose distances are computed in one vectorised loop
+static const int SCAN_CHUNK = 32;
+// the recent points are merged in once there are more of them than this and a quarter of all
+static const unsigned int MIN_RECENT_NUM = 64;
+
+GridHashIndex::GridHashIndex() {
+    _size = 0;
+    _rebuild_num = 0;
+    init( 1, 1, 1.0 );
+}
+
+void GridHashIndex::init( int width, int height, double cell_size ) {
+    _width = std::max( width, 1 );
+    _height = std::max( height, 1 );
+    clear();
+    _rebuild( (int)ceil( cell_size ) );
+    _rebuild_num = 0;
+}
+
+void GridHashIndex::clear() {
+    _x.clear();
+    _y.clear();
+    _payload.clear();
+    std::fill( _cell_begin.begin(), _cell_begin.end(), 0 );
+    std::fill( _recent_head.begin(), _recent_head.end(), -1 );
+    _recent_next.clear();
+    _recent_x.clear();
+    _recent_y.clear();
+    _recent_payload.clear();
+    _size = 0;
+}
+
+int GridHashIndex::_get_col( int x ) const {
+    return std::min( std::max( x / _cell_size, 0 ), _col_num - 1 );
+}
+
+int GridHashIndex::_get_row( int y ) const {
+    return std::min( std::max( y / _cell_size, 0 ), _row_num - 1 );
+}
+
+void GridHashIndex::insert( POS2D pos, uint32_t payload ) {
+    int cell = _get_row( pos.d[1] ) * _col_num + _get_col( pos.d[0] );
+    _recent_next.push_back( _recent_head[cell] );
+    _recent_head[cell] = _recent_x.size();
+    _recent_x.push_back( pos.d[0] );
+    _recent_y.push_back( pos.d[1] );
+    _recent_payload.push_back( payload );
+    _size++;
+    if( _recent_x.size() > MIN_RECENT_NUM && _recent_x.size() * 4 > _size ) {
+        _rebuild( _cell_size );
+    }
+}
+
+void GridHashIndex::set_radius( double radius ) {
+    int cell_size = std::max( (int)ceil( radius ), 1 );
+    if( cell_size * 2 <= _cell_size ) {
+        _rebuild( cell_size );
+    }
+}
+
+void GridHashIndex::reserve( unsigned int point_num, double min_cell_size ) {
+    int cell_size = std::max( (int)ceil( min_cell_size ), 1 );
+    unsigned int cell_num = ( ( _width + cell_size - 1 ) / cell_size ) * ( ( _height + cell_size - 1 ) / cell_size );
+    _cell_begin.reserve( cell_num + 1 );
+    _recent_head.reserve( cell_num );
+    _x.reserve( point_num );
+    _y.reserve( point_num );
+    _payload.reserve( point_num );
+    _next_x.reserve( point_num );
+    _next_y.reserve( point_num );
+    _next_payload.reserve( point_num );
+    _point_cells.reserve( point_num );
+    // a rebuild runs once the recent points pass a quarter of all
+    unsigned int recent_num = point_num / 4 + MIN_RECENT_NUM + 1;
+    _recent_next.reserve( recent_num );
+    _recent_x.reserve( recent_num );
+    _recent_y.reserve( recent_num );
+    _recent_payload.reserve( recent_num );
+}
+
+// sorts all points by the cells of the new size
+void GridHashIndex::_rebuild( int cell_size ) {
+    _cell_size = std::max( cell_size, 1 );
+    _col_num = ( _width + _cell_size - 1 ) / _cell_size;
+    _row_num = ( _height + _cell_size - 1 ) / _cell_size;
+    int cell_num = _col_num * _row_num;
+
+    // the sorted points come first, then the recent ones
+    unsigned int sorted_num = _x.size();
+    unsigned int point_num = sorted_num + _recent_x.size();
+    _cell_begin.assign( cell_num + 1, 0 );
+    _point_cells.resize( point_num );
+    for( unsigned int i=0; i<point_num; i++ ) {
+        int32_t x = ( i < sorted_num ) ? _x[i] : _recent_x[i - sorted_num];
+        int32_t y = ( i < sorted_num ) ? _y[i] : _recent_y[i - sorted_num];
+        _point_cells[i] = _get_row( y ) * _col_num + _get_col( x );
+        _cell_begin[_point_cells[i] + 1]++;
+    }
+    for( int cell=0; cell<cell_num; cell++ ) {
+        _cell_begin[cell + 1] += _cell_begin[cell];
+    }
+    // _cell_begin[cell] runs up to the begin of the next cell, then moves back
+    _next_x.resize( point_num );
+    _next_y.resize( point_num );
+    _next_payload.resize( point_num );
+    for( unsigned int i=0; i<point_num; i++ ) {
+        uint32_t dst = _cell_begin[_point_cells[i]]++;
+        if( i < sorted_num ) {
+            _next_x[dst] = _x[i];
+            _next_y[dst] = _y[i];
+            _next_payload[dst] = _payload[i];
+        }
+        else {
+            _next_x[dst] = _recent_x[i - sorted_num];
+            _next_y[dst] = _recent_y[i - sorted_num];
+            _next_payload[dst] = _recent_payload[i - sorted_num];
+        }
+    }
+    for( int cell=cell_num; cell>0; cell-- ) {
+        _cell_begin[cell] = _cell_begin[cell - 1];
+    }
+    _cell_begin[0] = 0;
+    _x.swap( _next_x );
+    _y.swap( _next_y );
+    _payload.swap( _next_payload );
+
+    _recent_head.assign( cell_num, -1 );
+    _recent_next.clear();
+    _recent_x.clear();
+    _recent_y.clear();
+    _recent_payload.clear();
+    _rebuild_num++;
+}
+
+double GridHashIndex::_get_cell_dist_sq( int col, int row, const int32_t pos[2] ) const {
+    int32_t min[2] = { col * _cell_size, row * _cell_size };
+    double dist_sq = 0.0;
+    for( int dim=0; dim<2; dim++ ) {
+        double delta = 0.0;
+        if( pos[dim] < min[dim] ) {
+            delta = (double)min[dim] - pos[dim];
+        }
+        else if( pos[dim] > min[dim] + _cell_size - 1 ) {
+            delta = (double)pos[dim] - ( min[dim] + _cell_size - 1 );
+        }
+        dist_sq += delta * delta;
+    }
+    return dist_sq;
+}
+
+void GridHashIndex::_find_nearest_in_cell( int cell, const int32_t pos[2], double& best_dist_sq, uint32_t& payload ) const {
+    double dist_sq[SCAN_CHUNK];
+    for( uint32_t chunk = _cell_begin[cell]; chunk < _cell_begin[cell + 1]; chunk += SCAN_CHUNK ) {
+        int num = std::min( _cell_begin[cell + 1] - chunk, (uint32_t)SCAN_CHUNK );
+        const int32_t* p_x = &_x[chunk];
+        const int32_t* p_y = &_y[chunk];
+        for( int i=0; i<num; i++ ) {
+            double dx = (double)( p_x[i] - pos[0] );
+            double dy = (double)( p_y[i] - pos[1] );
+            dist_sq[i] = dx*dx + dy*dy;
+        }
+        for( int i=0; i<num; i++ ) {
+            if( dist_sq[i] < best_dist_sq ) {
+                best_dist_sq = dist_sq[i];
+                payload = _payload[chunk + i];
+            }
+        }
+    }
+    for( int32_t i = _recent_head[cell]; i >= 0; i = _recent_next[i] ) {
+        double dx = (double)( _recent_x[i] - pos[0] );
+        double dy = (double)( _recent_y[i] - pos[1] );
+        if( dx*dx + dy*dy < best_dist_sq ) {
+            best_dist_sq = dx*dx + dy*dy;
+            payload = _recent_payload[i];
+        }
+    }
+}
+
+void GridHashIndex::_find_within_radius_in_cell( int cell, const int32_t pos[2], double radius_sq, std::vector<uint32_t>& payloads ) const {
+    double dist_sq[SCAN_CHUNK];
+    for( uint32_t chunk = _cell_begin[cell]; chunk < _cell_begin[cell + 1]; chunk += SCAN_CHUNK ) {
+        int num = std::min( _cell_begin[cell + 1] - chunk, (uint32_t)SCAN_CHUNK );
+        const int32_t* p_x = &_x[chunk];
+        const int32_t* p_y = &_y[chunk];
+        for( int i=0; i<num; i++ ) {
+            double dx = (double)( p_x[i] - pos[0] );
+            double dy = (double)( p_y[i] - pos[1] );
+            dist_sq[i] = dx*dx + dy*dy;
+        }
+        for( int i=0; i<num; i++ ) {
+            if( dist_sq[i] <= radius_sq ) {
+                payloads.push_back( _payload[chunk + i] );
+            }
+        }
+    }
+    for( int32_t i = _recent_head[cell]; i >= 0; i = _recent_next[i] ) {
+        double dx = (double)( _recent_x[i] - pos[0] );
+        double dy = (double)( _recent_y[i] - pos[1] );
+        if( dx*dx + dy*dy <= radius_sq ) {
+            payloads.push_back( _recent_payload[i] );
+        }
+    }
+}
+
+bool GridHashIndex::find_nearest( POS2D pos, uint32_t& payload ) const {
+    if( _size == 0 ) {
+        return false;
+    }
+    int col = _get_col( pos.d[0] );
+    int row = _get_row( pos.d[1] );
+    int max_ring = std::max( std::max( col, _col_num - 1 - col ), std::max( row, _row_num - 1 - row ) );
+    double best_dist_sq = std::numeric_limits<double>::max();
+    // rings of cells around the cell of pos, ring k is at least k-1 cells away
+    for( int ring=0; ring<=max_ring; ring++ ) {
+        double ring_dist = (double)( ring - 1 ) * _cell_size;
+        if( ring > 1 && ring_dist * ring_dist >= best_dist_sq ) {
+            break;
+        }
+        for( int r = std::max( row - ring, 0 ); r <= std::min( row + ring, _row_num - 1 ); r++ ) {
+            // inner rows of the ring only have its left and right cell
+            int step = ( r == row - ring || r == row + ring ) ? 1 : 2 * ring;
+            for( int c = col - ring; c <= col + ring; c += std::max( step, 1 ) ) {
+                if( c < 0 || c >= _col_num ) {
+                    continue;
+                }
+                if( _get_cell_dist_sq( c, r, pos.d ) < best_dist_sq ) {
+                    _find_nearest_in_cell( r * _col_num + c, pos.d, best_dist_sq, payload );
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void GridHashIndex::find_within_radius( POS2D pos, double radius, std::vector<uint32_t>& payloads ) const {
+    if( _size == 0 ) {
+        return;
+    }
+    double radius_sq = radius * radius;
+    int col_begin = _get_col( (int)floor( pos.d[0] - radius ) );
+    int col_end = _get_col( (int)ceil( pos.d[0] + radius ) );
+    int row_begin = _get_row( (int)floor( pos.d[1] - radius ) );
+    int row_end = _get_row( (int)ceil( pos.d[1] + radius ) );
+    for( int r = row_begin; r <= row_end; r++ ) {
+        for( int c = col_begin; c <= col_end; c++ ) {
+            if( _get_cell_dist_sq( c, r, pos.d ) <= radius_sq ) {
+                _find_within_radius_in_cell( r * _col_num + c, pos.d, radius_sq, payloads );
+            }
+        }
+    }
+}
+
+bool GridHashIndex::contains( POS2D pos ) const {
+    if( _size == 0 ) {
+        return false;
+    }
+    int cell = _get_row( pos.d[1] ) * _col_num + _get_col( pos.d[0] );
+    int match_num = 0;
+    for( uint32_t i = _cell_begin[cell]; i < _cell_begin[cell + 1]; i++ ) {
+        match_num += ( _x[i] == pos.d[0] && _y[i] == pos.d[1] ) ? 1 : 0;
+    }
+    for( int32_t i = _recent_head[cell]; i >= 0 && match_num == 0; i = _recent_next[i] ) {
+        match_num += ( _recent_x[i] == pos.d[0] && _recent_y[i] == pos.d[1] ) ? 1 : 0;
+    }
+    return match_num > 0;
+}
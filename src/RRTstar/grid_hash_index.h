@@ -0,0 +1,85 @@
+#ifndef GRID_HASH_INDEX_H
+#define GRID_HASH_INDEX_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "KDTree2D.h"
+
+/*
+ * 2D index of integer points on a width x height map, each with a 32-bit
+ * payload, bucketed into square cells about as large as the near radius
+ * so that a near query reads a 3x3 block of cells. Points are kept sorted
+ * by cell as of the last rebuild; points inserted since go to a linked
+ * list per cell and are merged in by the next rebuild, which runs once
+ * they are a quarter of the total or set_radius() halved the cell size.
+ * Queries are const and may run concurrently, insert() and set_radius()
+ * may not.
+ */
+class GridHashIndex {
+
+public:
+    GridHashIndex();
+
+    // clears the index, cells start at cell_size
+    void init( int width, int height, double cell_size );
+    void clear();
+    unsigned int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    // pos must lie on the map, queries may be anywhere
+    void insert( POS2D pos, uint32_t payload );
+    // rebuckets once radius is below half of the cell size
+    void set_radius( double radius );
+    // room for point_num points in cells down to min_cell_size, so that
+    // neither insert() nor set_radius() allocate before
+    void reserve( unsigned int point_num, double min_cell_size );
+
+    // false if the index is empty
+    bool find_nearest( POS2D pos, uint32_t& payload ) const;
+    // appends the payloads of the points at most radius away from pos
+    void find_within_radius( POS2D pos, double radius, std::vector<uint32_t>& payloads ) const;
+    bool contains( POS2D pos ) const;
+
+    int get_cell_size() const { return _cell_size; }
+    long get_rebuild_num() const { return _rebuild_num; }
+
+private:
+    int _get_col( int x ) const;
+    int _get_row( int y ) const;
+    double _get_cell_dist_sq( int col, int row, const int32_t pos[2] ) const;
+    void _rebuild( int cell_size );
+
+    void _find_nearest_in_cell( int cell, const int32_t pos[2], double& best_dist_sq, uint32_t& payload ) const;
+    void _find_within_radius_in_cell( int cell, const int32_t pos[2], double radius_sq, std::vector<uint32_t>& payloads ) const;
+
+    int _width;
+    int _height;
+    int _cell_size;
+    int _col_num;
+    int _row_num;
+
+    // points sorted by cell, those of a cell start at _cell_begin[cell]
+    std::vector<uint32_t> _cell_begin;
+    std::vector<int32_t>  _x;
+    std::vector<int32_t>  _y;
+    std::vector<uint32_t> _payload;
+
+    // points inserted since the last rebuild, -1 ends a list
+    std::vector<int32_t>  _recent_head;
+    std::vector<int32_t>  _recent_next;
+    std::vector<int32_t>  _recent_x;
+    std::vector<int32_t>  _recent_y;
+    std::vector<uint32_t> _recent_payload;
+
+    // scratch buffers of _rebuild(), the next points are swapped with the current ones
+    std::vector<uint32_t> _point_cells;
+    std::vector<int32_t>  _next_x;
+    std::vector<int32_t>  _next_y;
+    std::vector<uint32_t> _next_payload;
+
+    unsigned int _size;
+    long _rebuild_num;
+};
+
+#endif // GRID_HASH_INDEX_H
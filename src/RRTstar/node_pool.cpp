@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "node_pool.h"
+
+NodePool::NodePool( size_t slot_size ) {
+    // slots keep the alignment of the pointers inside the nodes and of the free list
+    _slot_size = ( std::max( slot_size, sizeof(void*) ) + sizeof(void*) - 1 ) / sizeof(void*) * sizeof(void*);
+    _slab_idx = 0;
+    _next_slot = 0;
+    _p_free_list = NULL;
+    _allocated_num = 0;
+}
+
+NodePool::~NodePool() {
+    for( unsigned int i=0; i<_slabs.size(); i++ ) {
+        ::operator delete( _slabs[i] );
+    }
+    _slabs.clear();
+}
+
+void NodePool::reserve( unsigned int slot_num ) {
+    while( _slabs.size() * SLAB_SLOT_NUM < slot_num ) {
+        _slabs.push_back( static_cast<char*>( ::operator new( _slot_size * SLAB_SLOT_NUM ) ) );
+    }
+}
+
+void* NodePool::allocate() {
+    _allocated_num++;
+    if( _p_free_list ) {
+        void* p_slot = _p_free_list;
+        _p_free_list = *static_cast<void**>( p_slot );
+        return p_slot;
+    }
+    if( _next_slot == SLAB_SLOT_NUM ) {
+        _slab_idx++;
+        _next_slot = 0;
+    }
+    if( _slab_idx == _slabs.size() ) {
+        _slabs.push_back( static_cast<char*>( ::operator new( _slot_size * SLAB_SLOT_NUM ) ) );
+    }
+    return _slabs[_slab_idx] + _slot_size * _next_slot++;
+}
+
+void NodePool::deallocate( void* p_slot ) {
+    _allocated_num--;
+    *static_cast<void**>( p_slot ) = _p_free_list;
+    _p_free_list = p_slot;
+}
+
+void NodePool::reset() {
+    _slab_idx = 0;
+    _next_slot = 0;
+    _p_free_list = NULL;
+    _allocated_num = 0;
+}
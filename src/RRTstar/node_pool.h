@@ -0,0 +1,94 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+/*
+ * Fixed-size slots carved out of large slabs, handed out in address
+ * order so that nodes allocated one after the other sit next to each
+ * other. Freed slots go to a free list and are handed out first.
+ * reset() forgets every slot at once and keeps the slabs for reuse.
+ */
+class NodePool {
+
+public:
+    static const unsigned int SLAB_SLOT_NUM = 4096;
+
+    NodePool( size_t slot_size );
+    ~NodePool();
+
+    // slabs for slot_num slots in all
+    void reserve( unsigned int slot_num );
+    void* allocate();
+    void deallocate( void* p_slot );
+    // O(1), whatever is in the slots is not destroyed
+    void reset();
+
+    size_t get_slot_size() const { return _slot_size; }
+    unsigned int get_slab_num() const { return _slabs.size(); }
+    unsigned int get_allocated_num() const { return _allocated_num; }
+
+private:
+    NodePool( const NodePool& other );
+    NodePool& operator=( const NodePool& other );
+
+    size_t _slot_size;
+    std::vector<char*> _slabs;
+    // the next slot never handed out is _next_slot of slab _slab_idx
+    unsigned int _slab_idx;
+    unsigned int _next_slot;
+    void*        _p_free_list;
+    unsigned int _allocated_num;
+};
+
+/*
+ * Allocator of single objects from a NodePool, for the node allocator
+ * parameter of kdtree++. Without a pool, or for arrays, it falls back to
+ * operator new. Copies share the pool.
+ */
+template <class T>
+class PoolAllocator {
+
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind { typedef PoolAllocator<U> other; };
+
+    PoolAllocator( NodePool* p_pool = NULL ) : mp_pool( p_pool ) {}
+    template <class U>
+    PoolAllocator( const PoolAllocator<U>& other ) : mp_pool( other.mp_pool ) {}
+
+    T* allocate( size_t n ) {
+        if( mp_pool && n == 1 && sizeof(T) <= mp_pool->get_slot_size() ) {
+            return static_cast<T*>( mp_pool->allocate() );
+        }
+        return static_cast<T*>( ::operator new( n * sizeof(T) ) );
+    }
+    void deallocate( T* p, size_t n ) {
+        if( mp_pool && n == 1 && sizeof(T) <= mp_pool->get_slot_size() ) {
+            mp_pool->deallocate( p );
+            return;
+        }
+        ::operator delete( p );
+    }
+
+    void construct( T* p, const T& value ) { new( p ) T( value ); }
+    void destroy( T* p ) { p->~T(); }
+    size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+    bool operator==( const PoolAllocator& other ) const { return mp_pool == other.mp_pool; }
+    bool operator!=( const PoolAllocator& other ) const { return mp_pool != other.mp_pool; }
+
+    NodePool* mp_pool;
+};
+
+#endif // NODE_POOL_H
@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "occupancy_bitmap.h"
+
+OccupancyBitmap::OccupancyBitmap() {
+    _width = 0;
+    _height = 0;
+    _row_word_num = 0;
+    _col_word_num = 0;
+}
+
+void OccupancyBitmap::reset( int width, int height ) {
+    _width = width;
+    _height = height;
+    _row_word_num = ( width + 63 ) / 64;
+    _col_word_num = ( height + 63 ) / 64;
+
+    _row_bits.assign( (size_t)_row_word_num * height, 0 );
+    _col_bits.assign( (size_t)_col_word_num * width, 0 );
+}
+
+void OccupancyBitmap::build( GridView<const uint8_t> map, int threshold ) {
+    int width = map.get_width();
+    int height = map.get_height();
+    reset( width, height );
+
+    for( int j=0; j<height; j++ ) {
+        const uint8_t* p_cells = map.get_row( j );
+        uint64_t* p_row = &_row_bits[(size_t)j * _row_word_num];
+        for( int i=0; i<width; i++ ) {
+            if( p_cells[i] < threshold ) {
+                p_row[i >> 6] |= (uint64_t)1 << ( i & 63 );
+                _col_bits[(size_t)i * _col_word_num + ( j >> 6 )] |= (uint64_t)1 << ( j & 63 );
+            }
+        }
+    }
+}
+
+bool OccupancyBitmap::is_occupied( int x, int y ) const {
+    if( x < 0 || x >= _width || y < 0 || y >= _height ) {
+        return false;
+    }
+    return ( _row_bits[(size_t)y * _row_word_num + ( x >> 6 )] >> ( x & 63 ) ) & 1;
+}
+
+bool OccupancyBitmap::_any_bit_set( const uint64_t* p_bits, int begin, int end ) {
+    int first_word = begin >> 6;
+    int last_word = ( end - 1 ) >> 6;
+    uint64_t first_mask = ~(uint64_t)0 << ( begin & 63 );
+    uint64_t last_mask = ~(uint64_t)0 >> ( 63 - ( ( end - 1 ) & 63 ) );
+
+    if( first_word == last_word ) {
+        return ( p_bits[first_word] & first_mask & last_mask ) != 0;
+    }
+    if( p_bits[first_word] & first_mask ) {
+        return true;
+    }
+    for( int w=first_word+1; w<last_word; w++ ) {
+        if( p_bits[w] ) {
+            return true;
+        }
+    }
+    return ( p_bits[last_word] & last_mask ) != 0;
+}
+
+bool OccupancyBitmap::is_segment_free( POS2D pos_a, POS2D pos_b ) const {
+    if ( pos_a == pos_b ) {
+        return true;
+    }
+
+    // same cells as the Bresenham walk of RRTstar::_is_obstacle_free(),
+    // with the error term doubled so that it stays integral
+    int x1 = pos_a[0];
+    int y1 = pos_a[1];
+    int x2 = pos_b[0];
+    int y2 = pos_b[1];
+
+    const bool steep = ( abs(y2 - y1) > abs(x2 - x1) );
+    if ( steep ) {
+        std::swap( x1, y1 );
+        std::swap( x2, y2 );
+    }
+    if ( x1 > x2 ) {
+        std::swap( x1, x2 );
+        std::swap( y1, y2 );
+    }
+
+    const long dx = x2 - x1;
+    const long dy = abs( y2 - y1 );
+    const int ystep = (y1 < y2) ? 1 : -1;
+
+    // a steep line runs along columns, a flat one along rows
+    const uint64_t* p_bits = steep ? &_col_bits[0] : &_row_bits[0];
+    const int word_num = steep ? _col_word_num : _row_word_num;
+    const int major_size = steep ? _height : _width;
+    const int minor_size = steep ? _width : _height;
+
+    long error = dx;
+    int y = y1;
+    const int maxX = x2;
+
+    if( dy == 0 || dx >= SHORT_RUN_RATIO * dy ) {
+        // long runs, each run is tested a word at a time
+        int x = x1;
+        while( x < maxX ) {
+            // number of cells before the minor coordinate changes
+            long run = ( dy == 0 ) ? ( maxX - x ) : ( error / ( 2 * dy ) + 1 );
+            int run_end = ( run >= maxX - x ) ? maxX : x + (int)run;
+
+            if( y >= 0 && y < minor_size ) {
+                int begin = std::max( x, 0 );
+                int end = std::min( run_end, major_size );
+                if( begin < end && _any_bit_set( p_bits + (size_t)y * word_num, begin, end ) ) {
+                    return false;
+                }
+            }
+
+            error -= ( run_end - x ) * 2 * dy;
+            error += 2 * dx;
+            x = run_end;
+            y += ystep;
+        }
+        return true;
+    }
+
+    // short runs, cells are tested one bit at a time; the minor step is
+    // applied through a sign mask to keep the loop free of unpredictable branches
+    const long line_step = (long)ystep * word_num;
+    long line_offset = (long)y * word_num;
+    for( int x=x1; x<maxX; x++ ) {
+        if( (unsigned int)y < (unsigned int)minor_size && (unsigned int)x < (unsigned int)major_size
+            && ( ( p_bits[line_offset + ( x >> 6 )] >> ( x & 63 ) ) & 1 ) ) {
+            return false;
+        }
+        error -= 2 * dy;
+        const long carry = error >> ( sizeof(long) * 8 - 1 );
+        y += ystep & carry;
+        line_offset += line_step & carry;
+        error += ( 2 * dx ) & carry;
+    }
+    return true;
+}
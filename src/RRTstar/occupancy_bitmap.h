@@ -0,0 +1,51 @@
+#ifndef OCCUPANCY_BITMAP_H
+#define OCCUPANCY_BITMAP_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "KDTree2D.h"
+#include "grid.h"
+
+/*
+ * One bit per map cell, set when the cell is an obstacle. The bits are
+ * kept twice, row-major and column-major, so that every horizontal or
+ * vertical run of a Bresenham line is a contiguous bit range that can be
+ * tested 64 cells at a time.
+ */
+class OccupancyBitmap {
+
+public:
+    OccupancyBitmap();
+
+    void build( GridView<const uint8_t> map, int threshold );
+    // width x height map without obstacles
+    void reset( int width, int height );
+
+    bool is_occupied( int x, int y ) const;
+    // no bounds check, x and y must lie inside the map
+    bool is_occupied_in_map( int x, int y ) const {
+        return ( _row_bits[(size_t)y * _row_word_num + ( x >> 6 )] >> ( x & 63 ) ) & 1;
+    }
+    bool is_segment_free( POS2D pos_a, POS2D pos_b ) const;
+
+    int get_width() const { return _width; }
+    int get_height() const { return _height; }
+    bool empty() const { return _row_bits.empty(); }
+
+private:
+    // below this cells-per-run ratio a line is walked cell by cell
+    static const int SHORT_RUN_RATIO = 8;
+
+    static bool _any_bit_set( const uint64_t* p_bits, int begin, int end );
+
+    int _width;
+    int _height;
+    int _row_word_num;
+    int _col_word_num;
+
+    std::vector<uint64_t> _row_bits;
+    std::vector<uint64_t> _col_bits;
+};
+
+#endif // OCCUPANCY_BITMAP_H
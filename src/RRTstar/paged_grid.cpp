@@ -0,0 +1,153 @@
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "paged_grid.h"
+
+TileCache::TileCache() {
+    _fd = -1;
+    memset( &_header, 0, sizeof(_header) );
+    _tile_shift = 0;
+    _tile_x_num = 0;
+    _tile_bytes = 0;
+    _slot_num = 0;
+    _used_slot_num = 0;
+    _lru_head = -1;
+    _lru_tail = -1;
+    _load_num = 0;
+}
+
+TileCache::~TileCache() {
+    close();
+}
+
+bool TileCache::open( const std::string& filename, GridCellType cell_type, size_t memory_budget ) {
+    close();
+
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat file_stat;
+    GridFileHeader header;
+    if( fstat( fd, &file_stat ) != 0 || pread( fd, &header, sizeof(header), 0 ) != (ssize_t)sizeof(header)
+        || false == is_grid_file_header_valid( header, file_stat.st_size )
+        || header.m_tile_size == 0 || header.m_cell_type != (uint32_t)cell_type ) {
+        ::close( fd );
+        return false;
+    }
+
+    _fd = fd;
+    _header = header;
+    _tile_shift = 0;
+    while( ( 1u << _tile_shift ) < header.m_tile_size ) {
+        _tile_shift++;
+    }
+    _tile_x_num = ( header.m_width + header.m_tile_size - 1 ) >> _tile_shift;
+    int tile_y_num = ( header.m_height + header.m_tile_size - 1 ) >> _tile_shift;
+    _tile_bytes = (size_t)header.m_tile_size * header.m_tile_size * get_grid_cell_size( header.m_cell_type );
+
+    int tile_num = _tile_x_num * tile_y_num;
+    size_t slot_num = memory_budget / _tile_bytes;
+    if( slot_num < 1 ) {
+        slot_num = 1;
+    }
+    if( slot_num > (size_t)tile_num ) {
+        slot_num = tile_num;
+    }
+    _slot_num = slot_num;
+    _tile_slots.assign( tile_num, -1 );
+    _slot_tiles.assign( _slot_num, -1 );
+    _slot_prev.assign( _slot_num, -1 );
+    _slot_next.assign( _slot_num, -1 );
+    _buffer.resize( (size_t)_slot_num * _tile_bytes );
+    return true;
+}
+
+void TileCache::close() {
+    if( _fd >= 0 ) {
+        ::close( _fd );
+        _fd = -1;
+    }
+    memset( &_header, 0, sizeof(_header) );
+    _tile_slots.clear();
+    _slot_tiles.clear();
+    _slot_prev.clear();
+    _slot_next.clear();
+    std::vector<uint8_t>().swap( _buffer );
+    _slot_num = 0;
+    _used_slot_num = 0;
+    _lru_head = -1;
+    _lru_tail = -1;
+    _load_num = 0;
+}
+
+void TileCache::_unlink_slot( int slot_idx ) {
+    int prev = _slot_prev[slot_idx];
+    int next = _slot_next[slot_idx];
+    if( prev >= 0 ) {
+        _slot_next[prev] = next;
+    }
+    else {
+        _lru_head = next;
+    }
+    if( next >= 0 ) {
+        _slot_prev[next] = prev;
+    }
+    else {
+        _lru_tail = prev;
+    }
+}
+
+void TileCache::_push_front_slot( int slot_idx ) {
+    _slot_prev[slot_idx] = -1;
+    _slot_next[slot_idx] = _lru_head;
+    if( _lru_head >= 0 ) {
+        _slot_prev[_lru_head] = slot_idx;
+    }
+    _lru_head = slot_idx;
+    if( _lru_tail < 0 ) {
+        _lru_tail = slot_idx;
+    }
+}
+
+const uint8_t* TileCache::get_tile( int tile_idx ) {
+    int slot_idx = _tile_slots[tile_idx];
+    if( slot_idx >= 0 ) {
+        if( slot_idx != _lru_head ) {
+            _unlink_slot( slot_idx );
+            _push_front_slot( slot_idx );
+        }
+        return &_buffer[(size_t)slot_idx * _tile_bytes];
+    }
+
+    if( _used_slot_num < _slot_num ) {
+        slot_idx = _used_slot_num;
+        _used_slot_num++;
+    }
+    else {
+        slot_idx = _lru_tail;
+        _unlink_slot( slot_idx );
+        _tile_slots[_slot_tiles[slot_idx]] = -1;
+    }
+
+    uint8_t* p_tile = &_buffer[(size_t)slot_idx * _tile_bytes];
+    off_t offset = _header.m_data_offset + (off_t)tile_idx * _tile_bytes;
+    size_t read_bytes = 0;
+    while( read_bytes < _tile_bytes ) {
+        ssize_t ret = pread( _fd, p_tile + read_bytes, _tile_bytes - read_bytes, offset + read_bytes );
+        if( ret <= 0 ) {
+            memset( p_tile + read_bytes, 0, _tile_bytes - read_bytes );
+            break;
+        }
+        read_bytes += ret;
+    }
+    _load_num++;
+
+    _slot_tiles[slot_idx] = tile_idx;
+    _tile_slots[tile_idx] = slot_idx;
+    _push_front_slot( slot_idx );
+    return p_tile;
+}
@@ -0,0 +1,152 @@
+#ifndef PAGED_GRID_H
+#define PAGED_GRID_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "grid_file.h"
+#include "segment_walk.h"
+
+/*
+ * Tiles of a tiled grid file, read on first touch into a fixed pool of
+ * tile buffers and evicted least recently used first once the pool,
+ * sized by the memory budget, is full. A tile that cannot be read comes
+ * back zero filled, i.e. as obstacles for an obstacle map.
+ */
+class TileCache {
+
+public:
+    TileCache();
+    ~TileCache();
+
+    bool open( const std::string& filename, GridCellType cell_type, size_t memory_budget );
+    void close();
+    bool is_open() const { return _fd >= 0; }
+
+    const uint8_t* get_tile( int tile_idx );
+
+    const GridFileHeader& get_header() const { return _header; }
+    int get_tile_shift() const { return _tile_shift; }
+    int get_tile_x_num() const { return _tile_x_num; }
+
+    int get_slot_num() const { return _slot_num; }
+    int get_resident_tile_num() const { return _used_slot_num; }
+    long get_load_num() const { return _load_num; }
+
+private:
+    TileCache( const TileCache& other );
+    TileCache& operator=( const TileCache& other );
+
+    void _unlink_slot( int slot_idx );
+    void _push_front_slot( int slot_idx );
+
+    int _fd;
+    GridFileHeader _header;
+    int    _tile_shift;
+    int    _tile_x_num;
+    size_t _tile_bytes;
+
+    // slot of each tile, -1 while it is not resident
+    std::vector<int> _tile_slots;
+    // per slot: its tile and its neighbours in the LRU list
+    std::vector<int> _slot_tiles;
+    std::vector<int> _slot_prev;
+    std::vector<int> _slot_next;
+    std::vector<uint8_t> _buffer;
+    int  _slot_num;
+    int  _used_slot_num;
+    int  _lru_head;
+    int  _lru_tail;
+    long _load_num;
+};
+
+/*
+ * Read-only grid of cells of type T paged in from a tiled grid file.
+ * Reads from the last touched tile skip the cache, so walking a segment
+ * only goes through the LRU list when it crosses a tile border. Not
+ * thread safe, even for reads.
+ */
+template <class T>
+class PagedGrid {
+
+public:
+    PagedGrid() : _last_tile_idx( -1 ), _p_last_tile( NULL ), _tile_shift( 0 ), _tile_mask( 0 ), _tile_x_num( 0 ) {}
+
+    bool open( const std::string& filename, size_t memory_budget ) {
+        _last_tile_idx = -1;
+        _p_last_tile = NULL;
+        if( false == _cache.open( filename, GridCellTraits<T>::CELL_TYPE, memory_budget ) ) {
+            return false;
+        }
+        _tile_shift = _cache.get_tile_shift();
+        _tile_mask = ( 1 << _tile_shift ) - 1;
+        _tile_x_num = _cache.get_tile_x_num();
+        return true;
+    }
+    void close() {
+        _cache.close();
+        _last_tile_idx = -1;
+        _p_last_tile = NULL;
+    }
+    bool is_open() const { return _cache.is_open(); }
+
+    // no bounds check, x and y must lie inside the grid
+    T operator()( int x, int y ) {
+        int tile_idx = ( y >> _tile_shift ) * _tile_x_num + ( x >> _tile_shift );
+        if( tile_idx != _last_tile_idx ) {
+            _p_last_tile = reinterpret_cast<const T*>( _cache.get_tile( tile_idx ) );
+            _last_tile_idx = tile_idx;
+        }
+        return _p_last_tile[( ( y & _tile_mask ) << _tile_shift ) + ( x & _tile_mask )];
+    }
+
+    int get_width() const { return _cache.get_header().m_width; }
+    int get_height() const { return _cache.get_header().m_height; }
+    int get_threshold() const { return _cache.get_header().m_threshold; }
+    int get_tile_size() const { return _cache.get_header().m_tile_size; }
+
+    const TileCache& get_cache() const { return _cache; }
+
+private:
+    TileCache _cache;
+    int      _last_tile_idx;
+    const T* _p_last_tile;
+    int _tile_shift;
+    int _tile_mask;
+    int _tile_x_num;
+};
+
+class PagedFieldSum {
+public:
+    PagedFieldSum( PagedGrid<double>& field ) : m_field( field ), m_sum( 0.0 ) {}
+
+    bool operator()( int x, int y ) {
+        m_sum += m_field( x, y );
+        return true;
+    }
+
+    PagedGrid<double>& m_field;
+    double m_sum;
+};
+
+class PagedObstacleCheck {
+public:
+    PagedObstacleCheck( PagedGrid<uint8_t>& map, int threshold ) : m_map( map ), m_threshold( threshold ) {}
+
+    bool operator()( int x, int y ) {
+        return m_map( x, y ) >= m_threshold;
+    }
+
+    PagedGrid<uint8_t>& m_map;
+    int m_threshold;
+};
+
+// the paged counterpart of integrate_cost_field()
+inline double integrate_paged_field( POS2D pos_a, POS2D pos_b, PagedGrid<double>& field ) {
+    PagedFieldSum sum( field );
+    walk_segment( pos_a, pos_b, field.get_width(), field.get_height(), sum );
+    return sum.m_sum;
+}
+
+#endif // PAGED_GRID_H
@@ -1,8 +1,11 @@
-#include <limits>
 #include <iostream>
 #include <fstream>
+#include <new>
+#include <algorithm>
+#include <limits>
 
 #include "rrtstar.h"
+#include "worker_pool.h"
 
 #define OBSTACLE_THRESHOLD 200
 
@@ -10,12 +13,66 @@ RRTNode::RRTNode(POS2D pos) {
     m_pos = pos;
     m_cost = 0.0;
     mp_parent = NULL;
+    m_index = 0;
+    m_goal_connection = -1;
+    mp_first_child = NULL;
+    mp_next_sibling = NULL;
+    mp_prev_sibling = NULL;
 }
 
 bool RRTNode::operator==(const RRTNode &other) {
     return m_pos==other.m_pos;
 }
 
+RRTNodeArena::RRTNodeArena() {
+    _size = 0;
+}
+
+RRTNodeArena::~RRTNodeArena() {
+    clear();
+    for( unsigned int i=0; i<_blocks.size(); i++ ) {
+        ::operator delete( _blocks[i] );
+    }
+    _blocks.clear();
+}
+
+RRTNode* RRTNodeArena::create( POS2D pos ) {
+    unsigned int block_idx = _size >> BLOCK_SHIFT;
+    if( block_idx == _blocks.size() ) {
+        _blocks.push_back( static_cast<RRTNode*>( ::operator new( sizeof(RRTNode) * BLOCK_SIZE ) ) );
+    }
+    RRTNode* p_node = new( _blocks[block_idx] + ( _size & BLOCK_MASK ) ) RRTNode( pos );
+    p_node->m_index = _size;
+    _size++;
+    return p_node;
+}
+
+void RRTNodeArena::reserve( unsigned int node_num ) {
+    while( _blocks.size() * BLOCK_SIZE < node_num ) {
+        _blocks.push_back( static_cast<RRTNode*>( ::operator new( sizeof(RRTNode) * BLOCK_SIZE ) ) );
+    }
+}
+
+void RRTNodeArena::clear() {
+    // blocks are kept for reuse, only the nodes are destroyed
+    for( unsigned int i=0; i<_size; i++ ) {
+        (*this)[i]->~RRTNode();
+    }
+    _size = 0;
+}
+
+unsigned int RRTNodeArena::get_block_size( unsigned int block_idx ) const {
+    if( block_idx + 1 < get_block_num() ) {
+        return BLOCK_SIZE;
+    }
+    return _size - ( block_idx << BLOCK_SHIFT );
+}
+
+ExtendCandidate::ExtendCandidate() {
+    mp_nearest_node = NULL;
+    m_rejection = REJECT_ON_NEAREST;
+}
+
 Path::Path(POS2D start, POS2D goal) {
     m_start = start;
     m_goal = goal;
@@ -26,92 +83,311 @@ Path::~Path() {
     m_cost = 0.0;
 }
 
-RRTstar::RRTstar( int width, int height, int segment_length ) {
+RRTstarBase::RRTstarBase( int width, int height, int segment_length, MapRepresentation map_representation ) {
 
     _sampling_width = width;
     _sampling_height = height;
     _segment_length = segment_length;
     _p_root = NULL;
 
-    _p_kd_tree = new KDTree2D( std::ptr_fun(tac) );
+    _near_index_type = BUCKET_KDTREE_INDEX;
+    _index_type_in_use = _near_index_type;
+    _p_kd_node_pool = new NodePool( sizeof(KDTree2DNode) );
+    _p_kd_tree = new KDTree2D( _p_kd_node_pool );
 
     _range = (_sampling_width > _sampling_height) ? _sampling_width:_sampling_height;
     _ball_radius = _range;
     _obs_check_resolution = 1;
     _current_iteration = 0;
+    _last_propagation_num = 0;
     _segment_length = segment_length;
 
-    _theta = 10;
+    _p_worker_pool = NULL;
+    _batch_size = 256;
 
-    _pp_cost_distribution = NULL;
+    _stall_iteration_num = 0;
+    _min_improvement = 0.0;
+    _stalled = false;
 
-    _pp_map_info = new int*[_sampling_width];
-    for(int i=0;i<_sampling_width;i++) {
-        _pp_map_info[i] = new int[_sampling_height];
-        for(int j=0;j<_sampling_height;j++) {
-            _pp_map_info[i][j] = 255;
-        }
-    }
+    _goal_radius = segment_length;
+    _p_best_goal_node = NULL;
+    _best_goal_cost = std::numeric_limits<double>::max();
+
+    _theta = 10;
 
-    _nodes.clear();
+    _symmetric_cost = true;
+    _clearance_map_enabled = true;
+
+    _map_representation = map_representation;
+    _obstacle_threshold = OBSTACLE_THRESHOLD;
+    // nothing is allocated until a map is given, see _load_blank_map()
+    _p_tiled_map = NULL;
 }
 
-RRTstar::~RRTstar() {
+RRTstarBase::~RRTstarBase() {
     if(_p_kd_tree) {
+        // the nodes go with their pool
+        _p_kd_tree->release_nodes();
         delete _p_kd_tree;
         _p_kd_tree = NULL;
     }
+    if(_p_kd_node_pool) {
+        delete _p_kd_node_pool;
+        _p_kd_node_pool = NULL;
+    }
+    if(_p_worker_pool) {
+        delete _p_worker_pool;
+        _p_worker_pool = NULL;
+    }
 }
 
-RRTNode* RRTstar::init( POS2D start, POS2D goal, COST_FUNC_PTR p_func, double** pp_cost_distribution ) {
+void RRTstarBase::set_worker_num( int worker_num ) {
+    if( _p_worker_pool ) {
+        delete _p_worker_pool;
+        _p_worker_pool = NULL;
+    }
+    if( worker_num > 0 ) {
+        _p_worker_pool = new WorkerPool( worker_num );
+    }
+}
+
+int RRTstarBase::get_worker_num() {
+    if( _p_worker_pool ) {
+        return _p_worker_pool->get_worker_num();
+    }
+    return 0;
+}
+
+void RRTstarBase::reserve( int node_num ) {
+    _nodes.reserve( node_num );
+    _goal_connections.reserve( node_num );
+
+    // a near set holds nodes on distinct cells within the ball radius, which
+    // shrinks as the tree grows
+    unsigned int near_num = 0;
+    for( int m=1; m<=node_num; m++ ) {
+        double side = 2.0 * floor( _get_ball_radius( m ) ) + 1.0;
+        near_num = std::max( near_num, (unsigned int)std::min( (double)m, side * side ) );
+    }
+    _near_node_indices.reserve( near_num );
+    _near_rnodes.reserve( near_num );
+    _near_edges.reserve( near_num );
+
+    switch( _index_type_in_use ) {
+    case KDTREE_INDEX:
+        _p_kd_node_pool->reserve( node_num );
+        break;
+    case BUCKET_KDTREE_INDEX:
+        _bucket_kd_tree.reserve( node_num );
+        break;
+    case GRID_INDEX:
+        // the cells shrink along with the ball radius
+        _grid_index.reserve( node_num, _get_ball_radius( node_num ) );
+        break;
+    }
+}
+
+RRTNode* RRTstarBase::_init_tree( POS2D start, POS2D goal, GridView<const double> cost_distribution ) {
     if( _p_root ) {
-        delete _p_root;
+        _p_kd_tree->release_nodes();
+        _p_kd_node_pool->reset();
+        _bucket_kd_tree.clear();
+        _nodes.clear();
         _p_root = NULL;
     }
     _start = start;
     _goal = goal;
-    _p_cost_func = p_func;
 
-    if(pp_cost_distribution) {
-        if(_pp_cost_distribution == NULL) {
-            _pp_cost_distribution = new double*[_sampling_width];
-            for(int i=0;i<_sampling_width;i++) {
-                _pp_cost_distribution[i] = new double[_sampling_height];
-            }
+    if( false == _has_map() ) {
+        _load_blank_map();
+    }
+
+    if( false == cost_distribution.empty() ) {
+        _copy_cost_distribution( cost_distribution );
+    }
+    else {
+        _cost_distribution.clear();
+        _cost_view = _cost_distribution;
+    }
+
+    _index_type_in_use = _near_index_type;
+    _grid_index.init( _sampling_width, _sampling_height, _range );
+    _p_root = _nodes.create( start );
+    _insert_into_index( _p_root );
+    _current_iteration = 0;
+
+    _goal_connections.clear();
+    _p_best_goal_node = NULL;
+    _best_goal_cost = std::numeric_limits<double>::max();
+
+    return _p_root;
+}
+
+bool RRTstarBase::_is_in_goal_region( POS2D pos ) {
+    double delta_x = pos[0] - _goal[0];
+    double delta_y = pos[1] - _goal[1];
+    return delta_x*delta_x + delta_y*delta_y <= _goal_radius*_goal_radius;
+}
+
+void RRTstarBase::_add_goal_connection( RRTNode* p_node, double delta_cost ) {
+    p_node->m_goal_connection = _goal_connections.size();
+    _goal_connections.push_back( delta_cost );
+    _update_goal_connection( p_node );
+}
+
+void RRTstarBase::set_early_termination( int stall_iteration_num, double min_improvement ) {
+    _stall_iteration_num = stall_iteration_num;
+    _min_improvement = min_improvement;
+}
+
+void RRTstarBase::_attach_cost_distribution( GridView<const double> cost_distribution ) {
+    // the edge walks read every cell of the map, other sizes cannot be used in place
+    if( false == cost_distribution.empty()
+        && ( cost_distribution.get_width() != _sampling_width || cost_distribution.get_height() != _sampling_height ) ) {
+        _copy_cost_distribution( cost_distribution );
+        return;
+    }
+    _cost_distribution.clear();
+    _cost_view = cost_distribution;
+}
+
+// cells beyond the distribution cost nothing, those beyond the map are dropped
+void RRTstarBase::_copy_cost_distribution( GridView<const double> cost_distribution ) {
+    if( cost_distribution.get_width() == _sampling_width && cost_distribution.get_height() == _sampling_height ) {
+        _cost_distribution.assign( cost_distribution );
+    }
+    else {
+        _cost_distribution.resize( _sampling_width, _sampling_height, 0.0 );
+        int width = std::min( _sampling_width, cost_distribution.get_width() );
+        int height = std::min( _sampling_height, cost_distribution.get_height() );
+        for(int j=0;j<height;j++) {
+            const double* p_src = cost_distribution.get_row( j );
+            std::copy( p_src, p_src + width, _cost_distribution.get_row( j ) );
         }
-        for(int i=0;i<_sampling_width;i++) {
-            for(int j=0;j<_sampling_height;j++) {
-                _pp_cost_distribution[i][j] = pp_cost_distribution[i][j];
+    }
+    _cost_view = _cost_distribution;
+}
+
+void RRTstarBase::load_map( GridView<const uint8_t> map ) {
+    if( _map_representation == TILED_MAP ) {
+        return;
+    }
+    int width = std::min( _sampling_width, map.get_width() );
+    int height = std::min( _sampling_height, map.get_height() );
+    if( _map_representation == BIT_MAP ) {
+        // the gray values are not kept, threshold them straight away
+        if( width == _sampling_width && height == _sampling_height ) {
+            _occupancy_bitmap.build( map.sub_view( 0, 0, width, height ), _obstacle_threshold );
+        }
+        else {
+            Grid<uint8_t> padded_map( _sampling_width, _sampling_height, 255 );
+            for(int j=0;j<height;j++) {
+                const uint8_t* p_src = map.get_row( j );
+                std::copy( p_src, p_src + width, padded_map.get_row( j ) );
             }
+            _occupancy_bitmap.build( padded_map, _obstacle_threshold );
         }
     }
     else {
-        if(_pp_cost_distribution) {
-            _pp_cost_distribution = NULL;
+        if( _map_info.empty() ) {
+            // the last map was attached
+            _map_info.resize( _sampling_width, _sampling_height, 255 );
+            _map_view = _map_info;
+        }
+        for(int j=0;j<height;j++) {
+            const uint8_t* p_src = map.get_row( j );
+            std::copy( p_src, p_src + width, _map_info.get_row( j ) );
         }
     }
+    update_map_info();
+}
 
-    KDNode2D root( start );
+void RRTstarBase::attach_map( GridView<const uint8_t> map ) {
+    // only a gray map of the planner's size is used in place
+    if( _map_representation == GRAY_MAP && map.get_width() == _sampling_width && map.get_height() == _sampling_height ) {
+        _map_info.clear();
+        _map_view = map;
+        update_map_info();
+    }
+    else {
+        load_map( map );
+    }
+}
 
-    _p_root = new RRTNode( start );
-    _nodes.push_back(_p_root);
-    root.setRRTNode(_p_root);
+bool RRTstarBase::attach_tiled_map( PagedGrid<uint8_t>* p_map ) {
+    if( _map_representation != TILED_MAP ) {
+        return false;
+    }
+    if( p_map && ( p_map->get_width() < _sampling_width || p_map->get_height() < _sampling_height ) ) {
+        return false;
+    }
+    _p_tiled_map = p_map;
+    return true;
+}
 
-    _p_kd_tree->insert( root );
-    _current_iteration = 0;
+GridView<uint8_t> RRTstarBase::get_map_info() {
+    if( _map_representation == GRAY_MAP && false == _has_map() ) {
+        _map_info.resize( _sampling_width, _sampling_height, 255 );
+        _map_view = _map_info;
+    }
+    return _map_info;
+}
 
-    return _p_root;
+bool RRTstarBase::_has_map() {
+    if( _map_representation == GRAY_MAP ) {
+        return false == _map_view.empty();
+    }
+    if( _map_representation == BIT_MAP ) {
+        return false == _occupancy_bitmap.empty();
+    }
+    return true;
+}
+
+// a planner initialised before any map was given plans on a free one
+void RRTstarBase::_load_blank_map() {
+    if( _map_representation == GRAY_MAP ) {
+        _map_info.resize( _sampling_width, _sampling_height, 255 );
+        _map_view = _map_info;
+    }
+    else if( _map_representation == BIT_MAP ) {
+        _occupancy_bitmap.reset( _sampling_width, _sampling_height );
+    }
+    update_map_info();
 }
 
-void RRTstar::load_map( int** pp_map ) {
-    for(int i=0;i<_sampling_width;i++) {
-        for(int j=0;j<_sampling_height;j++) {
-            _pp_map_info[i][j] = pp_map[i][j];
+void RRTstarBase::set_obstacle_threshold( int threshold ) {
+    if( threshold != _obstacle_threshold ) {
+        _obstacle_threshold = threshold;
+        if( _map_representation == GRAY_MAP && true == _has_map() ) {
+            update_map_info();
         }
     }
 }
 
-POS2D RRTstar::_sampling() {
+void RRTstarBase::update_map_info() {
+    if( false == _has_map() ) {
+        return;
+    }
+    if( _map_representation == GRAY_MAP ) {
+        _occupancy_bitmap.build( _map_view, _obstacle_threshold );
+    }
+    // a clearance map would need the whole map in memory
+    if( _clearance_map_enabled && _map_representation != TILED_MAP ) {
+        _clearance_map.build( _occupancy_bitmap );
+    }
+    else {
+        _clearance_map.clear();
+    }
+}
+
+void RRTstarBase::set_clearance_map_enabled( bool enabled ) {
+    if( enabled != _clearance_map_enabled ) {
+        _clearance_map_enabled = enabled;
+        update_map_info();
+    }
+}
+
+POS2D RRTstarBase::_sampling() {
     double x = rand();
     double y = rand();
     int int_x = x * ((double)(_sampling_width)/RAND_MAX);
@@ -121,7 +397,7 @@ POS2D RRTstar::_sampling() {
     return m;
 }
 
-POS2D RRTstar::_steer( POS2D pos_a, POS2D pos_b ) {
+POS2D RRTstarBase::_steer( POS2D pos_a, POS2D pos_b ) {
     POS2D new_pos( pos_a[0], pos_a[1] );
     double delta[2];
     delta[0] = pos_a[0] - pos_b[0];
@@ -139,150 +415,158 @@ POS2D RRTstar::_steer( POS2D pos_a, POS2D pos_b ) {
     return new_pos;
 }
 
-bool RRTstar::_is_in_obstacle( POS2D pos ) {
+bool RRTstarBase::_is_in_obstacle( POS2D pos ) {
     int x = (int)pos[0];
     int y = (int)pos[1];
-    if( _pp_map_info[x][y] < 255 ) {
+    if( _map_representation == BIT_MAP ) {
+        return _occupancy_bitmap.is_occupied( x, y );
+    }
+    if( _map_representation == TILED_MAP ) {
+        return _p_tiled_map && (*_p_tiled_map)( x, y ) < 255;
+    }
+    if( _map_view( x, y ) < 255 ) {
         return true;
     }
     return false;
 }
 
 
-bool RRTstar::_is_obstacle_free( POS2D pos_a, POS2D pos_b ) {
-    if ( pos_a == pos_b ) {
-        return true;
+bool RRTstarBase::_is_obstacle_free( POS2D pos_a, POS2D pos_b ) {
+    if( _map_representation == TILED_MAP ) {
+        if( NULL == _p_tiled_map ) {
+            return true;
+        }
+        PagedObstacleCheck check( *_p_tiled_map, _obstacle_threshold );
+        return walk_segment( pos_a, pos_b, _sampling_width, _sampling_height, check );
     }
-    int x_dist = pos_a[0] - pos_b[0];
-    int y_dist = pos_a[1] - pos_b[1];
-
-    if( x_dist == 0 && y_dist == 0) {
-        return true;
+    if( false == _clearance_map.empty() ) {
+        return _clearance_map.is_segment_free( pos_a, pos_b );
     }
+    return _occupancy_bitmap.is_segment_free( pos_a, pos_b );
+}
 
-    float x1 = pos_a[0];
-    float y1 = pos_a[1];
-    float x2 = pos_b[0];
-    float y2 = pos_b[1];
-
-    const bool steep = ( fabs(y2 - y1) > fabs(x2 - x1) );
-    if ( steep ) {
-        std::swap( x1, y1 );
-        std::swap( x2, y2 );
-    }
+bool RRTstarBase::_prepare_extension( POS2D rnd_pos, RRTNode*& p_nearest_node, POS2D& new_pos, ExtendRejection& rejection ) {
+    p_nearest_node = _find_nearest( rnd_pos );
 
-    if ( x1 > x2 ) {
-        std::swap( x1, x2 );
-        std::swap( y1, y2 );
+    if( NULL == p_nearest_node || rnd_pos == p_nearest_node->m_pos ) {
+        rejection = REJECT_ON_NEAREST;
+        return false;
     }
 
-    const float dx = x2 - x1;
-    const float dy = fabs( y2 - y1 );
-
-    float error = dx / 2.0f;
-    const int ystep = (y1 < y2) ? 1 : -1;
-    int y = (int)y1;
-
-    const int maxX = (int)x2;
+    new_pos = _steer( rnd_pos, p_nearest_node->m_pos );
 
-    for(int x=(int)x1; x<maxX; x++) {
-        if(steep) {
-            if ( y>=0 && y<_sampling_width && x>=0 && x<_sampling_height ) {
-                if ( _pp_map_info[y][x] < OBSTACLE_THRESHOLD ) {
-                    return false;
-                }
-            }
-        }
-        else {
-            if ( x>=0 && x<_sampling_width && y>=0 && y<_sampling_height ) {
-                if ( _pp_map_info[x][y] < OBSTACLE_THRESHOLD ) {
-                    return false;
-                }
-            }
-        }
-
-        error -= dy;
-        if(error < 0) {
-            y += ystep;
-            error += dx;
-        }
+    if( true == _contains(new_pos) ) {
+        rejection = REJECT_CONTAINED;
+        return false;
     }
+    if( true == _is_in_obstacle( new_pos ) ) {
+        rejection = REJECT_IN_OBSTACLE;
+        return false;
+    }
+    if( false == _is_obstacle_free( p_nearest_node->m_pos, new_pos ) ) {
+        rejection = REJECT_COLLISION;
+        return false;
+    }
+    rejection = EXTEND_ACCEPTED;
     return true;
 }
 
-void RRTstar::extend() {
-    bool node_inserted = false;
-    while( false==node_inserted ) {
-        POS2D rnd_pos = _sampling();
-        KDNode2D nearest_node = _find_nearest( rnd_pos );
-
-        if (rnd_pos[0]==nearest_node[0] && rnd_pos[1]==nearest_node[1]) {
-            continue;
-        }
-
-        POS2D new_pos = _steer( rnd_pos, nearest_node );
-
-        if( true == _contains(new_pos) ) {
-            continue;
-        }
-        if( true == _is_in_obstacle( new_pos ) ) {
-            continue;
-        }
+bool RRTstarBase::_prepare_serial_extension( POS2D rnd_pos, RRTNode*& p_nearest_node, POS2D& new_pos ) {
+    RRTSTAR_STATS_TIMER( PHASE_EXTENSION );
+    ExtendRejection rejection;
+    bool accepted = _prepare_extension( rnd_pos, p_nearest_node, new_pos, rejection );
+    RRTSTAR_STATS_ADD( m_extension_num[rejection], 1 );
+    return accepted;
+}
 
-        if( true == _is_obstacle_free( nearest_node, new_pos ) ) {
-            std::list<KDNode2D> near_list = _find_near( new_pos );
-            KDNode2D new_node( new_pos );
-
-            // create new node
-            RRTNode * p_new_rnode = _create_new_node( new_pos );
-            new_node.setRRTNode( p_new_rnode );
-
-            _p_kd_tree->insert( new_node );
-            node_inserted = true;
-
-            RRTNode* p_nearest_rnode = nearest_node.getRRTNode();
-            std::list<RRTNode*> near_rnodes;
-            near_rnodes.clear();
-            for( std::list<KDNode2D>::iterator itr = near_list.begin();
-                itr != near_list.end(); itr++ ) {
-                KDNode2D kd_node = (*itr);
-                RRTNode* p_near_rnode = kd_node.getRRTNode();
-                near_rnodes.push_back( p_near_rnode );
-            }
+void RRTstarBase::_prepare_candidates( int candidate_num ) {
+    RRTSTAR_STATS_TIMER( PHASE_PREPARE_BATCH );
+    RRTSTAR_STATS_ADD( m_sample_num, candidate_num );
+    // samples are drawn on this thread so the sequence does not depend on the worker count
+    _candidates.resize( candidate_num );
+    for( int i=0; i<candidate_num; i++ ) {
+        _candidates[i].m_rnd_pos = _sampling();
+    }
 
-            // attach new node to reference trees
-            _attach_new_node( p_new_rnode, p_nearest_rnode, near_rnodes );
-            // rewire near nodes of reference trees
-            _rewire_near_nodes( p_new_rnode, near_rnodes );
+    // the tile cache of a paged map is not thread safe
+    if( _p_worker_pool && _map_representation != TILED_MAP ) {
+        _p_worker_pool->run( candidate_num, _prepare_candidate_task, this );
+    }
+    else {
+        for( int i=0; i<candidate_num; i++ ) {
+            _prepare_candidate( i );
         }
     }
-    _current_iteration++;
 }
 
-KDNode2D RRTstar::_find_nearest( POS2D pos ) {
-    KDNode2D node( pos );
+void RRTstarBase::_prepare_candidate_task( int candidate_idx, void* p_tree ) {
+    static_cast<RRTstarBase*>( p_tree )->_prepare_candidate( candidate_idx );
+}
 
-    std::pair<KDTree2D::const_iterator,double> found = _p_kd_tree->find_nearest( node );
-    KDNode2D near_node = *found.first;
-    return near_node;
+void RRTstarBase::_prepare_candidate( int candidate_idx ) {
+    ExtendCandidate& candidate = _candidates[candidate_idx];
+    _prepare_extension( candidate.m_rnd_pos, candidate.mp_nearest_node, candidate.m_new_pos, candidate.m_rejection );
 }
 
-std::list<KDNode2D> RRTstar::_find_near(POS2D pos) {
-    std::list<KDNode2D> near_list;
-    KDNode2D node(pos);
+RRTNode* RRTstarBase::_find_nearest( POS2D pos ) {
+    uint32_t node_idx = 0;
+    bool found = false;
+    switch( _index_type_in_use ) {
+    case KDTREE_INDEX:
+        if( _p_kd_tree->size() > 0 ) {
+            KDNode2D node( pos );
+            node_idx = _p_kd_tree->find_nearest( node ).first->getNodeIndex();
+            found = true;
+        }
+        break;
+    case BUCKET_KDTREE_INDEX:
+        found = _bucket_kd_tree.find_nearest( pos, node_idx );
+        break;
+    case GRID_INDEX:
+        found = _grid_index.find_nearest( pos, node_idx );
+        break;
+    }
+    if( true == found ) {
+        return _nodes[node_idx];
+    }
+    return NULL;
+}
 
-    int num_vertices = _p_kd_tree->size();
+double RRTstarBase::_get_ball_radius( int node_num ) {
     int num_dimensions = 2;
-    _ball_radius =  _theta * _range * pow( log((double)(num_vertices + 1.0))/((double)(num_vertices + 1.0)), 1.0/((double)num_dimensions) );
-
-    _p_kd_tree->find_within_range( node, _ball_radius, std::back_inserter( near_list ) );
+    return _theta * _range * pow( log((double)(node_num + 1.0))/((double)(node_num + 1.0)), 1.0/((double)num_dimensions) );
+}
 
-    return near_list;
+void RRTstarBase::_find_near( POS2D pos, std::vector<uint32_t>& near_indices ) {
+    _ball_radius = _get_ball_radius( _nodes.size() );
+
+    near_indices.clear();
+    switch( _index_type_in_use ) {
+    case KDTREE_INDEX:
+        _p_kd_tree->find_within_radius( pos, _ball_radius, near_indices );
+        break;
+    case BUCKET_KDTREE_INDEX:
+        _bucket_kd_tree.find_within_radius( pos, _ball_radius, near_indices );
+        break;
+    case GRID_INDEX:
+        // the radius only shrinks, the cells follow it
+        _grid_index.set_radius( _ball_radius );
+        _grid_index.find_within_radius( pos, _ball_radius, near_indices );
+        break;
+    }
 }
 
 
-bool RRTstar::_contains( POS2D pos )
+bool RRTstarBase::_contains( POS2D pos )
 {
+    switch( _index_type_in_use ) {
+    case BUCKET_KDTREE_INDEX:
+        return _bucket_kd_tree.contains( pos );
+    case GRID_INDEX:
+        return _grid_index.contains( pos );
+    case KDTREE_INDEX:
+        break;
+    }
     if(_p_kd_tree) {
         KDNode2D node( pos[0], pos[1] );
         KDTree2D::const_iterator it = _p_kd_tree->find(node);
@@ -296,53 +580,58 @@ bool RRTstar::_contains( POS2D pos )
     return false;
 }
 
-double RRTstar::_calculate_cost( POS2D& pos_a, POS2D& pos_b ) {
-    return _p_cost_func(pos_a, pos_b, _pp_cost_distribution, this);
+void RRTstarBase::_insert_into_index( RRTNode* p_node ) {
+    switch( _index_type_in_use ) {
+    case KDTREE_INDEX: {
+        KDNode2D node( p_node->m_pos );
+        node.setNodeIndex( p_node->m_index );
+        _p_kd_tree->insert( node );
+        break;
+    }
+    case BUCKET_KDTREE_INDEX:
+        _bucket_kd_tree.insert( p_node->m_pos, p_node->m_index );
+        break;
+    case GRID_INDEX:
+        _grid_index.insert( p_node->m_pos, p_node->m_index );
+        break;
+    }
 }
 
-RRTNode* RRTstar::_create_new_node(POS2D pos) {
-    RRTNode * pNode = new RRTNode(pos);
-    _nodes.push_back(pNode);
-
-    return pNode;
+RRTNode* RRTstarBase::_create_new_node(POS2D pos) {
+    return _nodes.create(pos);
 }
 
-bool RRTstar::_remove_edge(RRTNode* p_node_parent, RRTNode*  p_node_child) {
-    if( p_node_parent==NULL ) {
+bool RRTstarBase::_remove_edge(RRTNode* p_node_parent, RRTNode*  p_node_child) {
+    if( p_node_parent==NULL || p_node_child==NULL ) {
+        return false;
+    }
+    if( p_node_child->mp_parent != p_node_parent ) {
         return false;
     }
 
-    p_node_child->mp_parent = NULL;
-    bool removed = false;
-    for( std::list<RRTNode*>::iterator it=p_node_parent->m_child_nodes.begin();it!=p_node_parent->m_child_nodes.end();it++ ) {
-        RRTNode* p_current = (RRTNode*)(*it);
-        if ( p_current == p_node_child || p_current->m_pos==p_node_child->m_pos ) {
-            p_current->mp_parent = NULL;
-            it = p_node_parent->m_child_nodes.erase(it);
-            removed = true;
-        }
+    if( p_node_child->mp_prev_sibling ) {
+        p_node_child->mp_prev_sibling->mp_next_sibling = p_node_child->mp_next_sibling;
+    }
+    else {
+        p_node_parent->mp_first_child = p_node_child->mp_next_sibling;
     }
-    return removed;
+    if( p_node_child->mp_next_sibling ) {
+        p_node_child->mp_next_sibling->mp_prev_sibling = p_node_child->mp_prev_sibling;
+    }
+    p_node_child->mp_parent = NULL;
+    p_node_child->mp_next_sibling = NULL;
+    p_node_child->mp_prev_sibling = NULL;
+    return true;
 }
 
-bool RRTstar::_has_edge(RRTNode* p_node_parent, RRTNode* p_node_child) {
+bool RRTstarBase::_has_edge(RRTNode* p_node_parent, RRTNode* p_node_child) {
     if ( p_node_parent == NULL || p_node_child == NULL ) {
         return false;
     }
-    for( std::list<RRTNode*>::iterator it=p_node_parent->m_child_nodes.begin();it!=p_node_parent->m_child_nodes.end();it++ ) {
-        RRTNode* p_curr_node = (*it);
-        if( p_curr_node == p_node_child ) {
-            return true;
-        }
-    }
-    /*
-    if (pNode_p == pNode_c->mpParent)
-        return true;
-    */
-    return false;
+    return p_node_child->mp_parent == p_node_parent;
 }
 
-bool RRTstar::_add_edge( RRTNode* p_node_parent, RRTNode* p_node_child ) {
+bool RRTstarBase::_add_edge( RRTNode* p_node_parent, RRTNode* p_node_child ) {
     if( p_node_parent == NULL || p_node_child == NULL || p_node_parent == p_node_child ) {
         return false;
     }
@@ -350,193 +639,63 @@ bool RRTstar::_add_edge( RRTNode* p_node_parent, RRTNode* p_node_child ) {
         return false;
     }
     if ( true == _has_edge( p_node_parent, p_node_child ) ) {
-        p_node_child->mp_parent = p_node_parent;
-    }
-    else {
-        p_node_parent->m_child_nodes.push_back( p_node_child );
-        p_node_child->mp_parent = p_node_parent;
+        return true;
     }
-    p_node_child->m_child_nodes.unique();
-
-    return true;
-}
-
-
-std::list<RRTNode*> RRTstar::_find_all_children( RRTNode* p_node ) {
-    int level = 0;
-    bool finished = false;
-    std::list<RRTNode*> child_list;
-
-    std::list<RRTNode*> current_level_nodes;
-    current_level_nodes.push_back( p_node );
-    while( false==finished ) {
-        std::list<RRTNode*> current_level_children;
-        int child_list_num = child_list.size();
-
-        for( std::list<RRTNode*>::iterator it=current_level_nodes.begin(); it!=current_level_nodes.end(); it++ ) {
-            RRTNode* pCurrentNode = (*it);
-            for( std::list<RRTNode*>::iterator itc=pCurrentNode->m_child_nodes.begin(); itc!=pCurrentNode->m_child_nodes.end();itc++ ) {
-                RRTNode *p_child_node= (*itc);
-                if(p_child_node) {
-                    current_level_children.push_back(p_child_node);
-                    child_list.push_back(p_child_node);
-                }
-            }
-        }
-
-        child_list.unique();
-        current_level_children.unique();
-
-        if (current_level_children.size()==0) {
-            finished = true;
-        }
-        else if (child_list.size()==child_list_num) {
-            finished = true;
-        }
-        else {
-            current_level_nodes.clear();
-            for( std::list<RRTNode*>::iterator itt=current_level_children.begin();itt!=current_level_children.end();itt++ ) {
-                RRTNode * pTempNode = (*itt);
-                if( pTempNode ) {
-                    current_level_nodes.push_back( pTempNode );
-                }
-            }
-            level +=1;
-        }
-
-        if(level>100) {
-            break;
-        }
+    if ( p_node_child->mp_parent ) {
+        _remove_edge( p_node_child->mp_parent, p_node_child );
     }
-    child_list.unique();
-    return child_list;
-}
-
-
-RRTNode* RRTstar::_find_ancestor(RRTNode* p_node) {
-    return get_ancestor( p_node );
-}
-
-Path* RRTstar::find_path() {
-    Path* p_new_path = new Path( _start, _goal );
 
-    std::list<RRTNode*> node_list;
-
-    RRTNode * p_first_node = NULL;
-    double delta_cost = 0.0;
-    _get_closet_to_goal( p_first_node, delta_cost );
-
-    if( p_first_node != NULL ) {
-        get_parent_node_list( p_first_node, node_list );
-        for( std::list<RRTNode*>::reverse_iterator rit=node_list.rbegin();
-            rit!=node_list.rend(); ++rit ) {
-            RRTNode* p_node = (*rit);
-            p_new_path->m_way_points.push_back( p_node->m_pos );
-        }
-        p_new_path->m_way_points.push_back(_goal);
-
-        p_new_path->m_cost = p_first_node->m_cost + delta_cost;
+    p_node_child->mp_prev_sibling = NULL;
+    p_node_child->mp_next_sibling = p_node_parent->mp_first_child;
+    if( p_node_parent->mp_first_child ) {
+        p_node_parent->mp_first_child->mp_prev_sibling = p_node_child;
     }
+    p_node_parent->mp_first_child = p_node_child;
+    p_node_child->mp_parent = p_node_parent;
 
-    return p_new_path;
+    return true;
 }
 
 
-void RRTstar::_attach_new_node(RRTNode* p_node_new, RRTNode* p_nearest_node, std::list<RRTNode*> near_nodes) {
-    double min_new_node_cost = p_nearest_node->m_cost + _calculate_cost(p_nearest_node->m_pos, p_node_new->m_pos);
-    RRTNode* p_min_node = p_nearest_node;
-
-    for(std::list<RRTNode*>::iterator it=near_nodes.begin();it!=near_nodes.end();it++) {
-        RRTNode* p_near_node = *it;
-        if ( true == _is_obstacle_free( p_near_node->m_pos, p_node_new->m_pos ) ) {
-            double delta_cost = _calculate_cost( p_near_node->m_pos, p_node_new->m_pos );
-            double new_cost = p_near_node->m_cost + delta_cost;
-            if ( new_cost < min_new_node_cost ) {
-                p_min_node = p_near_node;
-                min_new_node_cost = new_cost;
-            }
-        }
-    }
-
-    bool added = _add_edge( p_min_node, p_node_new );
-    if( added ) {
-        p_node_new->m_cost = min_new_node_cost;
-    }
-
+RRTNode* RRTstarBase::_find_ancestor(RRTNode* p_node) {
+    return get_ancestor( p_node );
 }
 
-void RRTstar::_rewire_near_nodes(RRTNode* p_node_new, std::list<RRTNode*> near_nodes) {
-    for( std::list<RRTNode*>::iterator it=near_nodes.begin(); it!=near_nodes.end(); it++ ) {
-        RRTNode * p_near_node = (*it);
-
-        if(p_near_node->m_pos ==p_node_new->m_pos ||  p_near_node->m_pos==_p_root->m_pos || p_node_new->mp_parent->m_pos==p_near_node->m_pos) {
+int RRTstarBase::_update_cost_to_children( RRTNode* p_node, double delta_cost ) {
+    // depth-first walk of the subtree below p_node along the child, sibling
+    // and parent links, so it needs no stack. Every descendant is visited once
+    int visited_num = 0;
+    RRTNode* p_current_node = p_node->mp_first_child;
+    while( p_current_node != NULL ) {
+        p_current_node->m_cost -= delta_cost;
+        _update_goal_connection( p_current_node );
+        visited_num++;
+
+        if( p_current_node->mp_first_child ) {
+            p_current_node = p_current_node->mp_first_child;
             continue;
         }
-
-        if( true == _is_obstacle_free( p_node_new->m_pos, p_near_node->m_pos ) ) {
-            double temp_delta_cost = _calculate_cost( p_node_new->m_pos, p_near_node->m_pos );
-            double temp_cost_from_new_node = p_node_new->m_cost + temp_delta_cost;
-            if( temp_cost_from_new_node < p_near_node->m_cost ) {
-                double min_delta_cost = p_near_node->m_cost - temp_cost_from_new_node;
-                RRTNode * p_parent_node = p_near_node->mp_parent;
-                bool removed = _remove_edge(p_parent_node, p_near_node);
-                if(removed) {
-                    bool added = _add_edge(p_node_new, p_near_node);
-                    if( added ) {
-                        p_near_node->m_cost = temp_cost_from_new_node;
-                        _update_cost_to_children(p_near_node, min_delta_cost);
-                    }
-                }
-                else {
-                    std::cout << " Failed in removing " << std::endl;
-                }
-            }
-        }
-    }
-}
-
-void RRTstar::_update_cost_to_children( RRTNode* p_node, double delta_cost ) {
-    std::list<RRTNode*> child_list = _find_all_children( p_node );
-    for( std::list<RRTNode*>::iterator it = child_list.begin(); it != child_list.end();it++ ) {
-        RRTNode* p_child_node = (*it);
-        if( p_child_node ) {
-            p_child_node->m_cost -= delta_cost;
-        }
-    }
-}
-
-bool RRTstar::_get_closet_to_goal( RRTNode*& p_node_closet_to_goal, double& delta_cost ) {
-    bool found = false;
-
-    std::list<KDNode2D> near_nodes = _find_near( _goal );
-    double min_total_cost = std::numeric_limits<double>::max();
-
-    for(std::list<KDNode2D>::iterator it=near_nodes.begin();
-        it!=near_nodes.end();it++) {
-        KDNode2D kd_node = (*it);
-        RRTNode* p_node = kd_node.getRRTNode();
-        double new_delta_cost = _calculate_cost(p_node->m_pos, _goal);
-        double new_total_cost= p_node->m_cost + new_delta_cost;
-        if (new_total_cost < min_total_cost) {
-            min_total_cost = new_total_cost;
-            p_node_closet_to_goal = p_node;
-            delta_cost = new_delta_cost;
-            found = true;
+        // back up to the nearest node with a next sibling, stopping at p_node
+        while( p_current_node != p_node && p_current_node->mp_next_sibling == NULL ) {
+            p_current_node = p_current_node->mp_parent;
         }
+        p_current_node = ( p_current_node == p_node ) ? NULL : p_current_node->mp_next_sibling;
     }
-    return found;
+    return visited_num;
 }
 
-void RRTstar::dump_distribution(std::string filename) {
+void RRTstarBase::dump_distribution(std::string filename) {
     std::ofstream myfile;
     myfile.open (filename.c_str());
-    if(_pp_cost_distribution) {
-        for(int i=0;i<_sampling_width;i++) {
-            for(int j=0;j<_sampling_height;j++) {
-                myfile << _pp_cost_distribution[i][j] << " ";
+    if( false == _cost_view.empty() ) {
+        for(int i=0;i<_cost_view.get_width();i++) {
+            for(int j=0;j<_cost_view.get_height();j++) {
+                myfile << _cost_view( i, j ) << " ";
             }
             myfile << "\n";
         }
     }
     myfile.close();
 }
+
+template class RRTstarT<FuncPtrCost>;
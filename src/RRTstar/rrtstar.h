@@ -3,10 +3,22 @@
 
 #include <vector>
 #include <list>
+#include <stdint.h>
+#include <chrono>
 
 #include "KDTree2D.h"
+#include "bucket_kdtree.h"
+#include "grid_hash_index.h"
+#include "grid.h"
+#include "occupancy_bitmap.h"
+#include "clearance_map.h"
+#include "paged_grid.h"
+#include "cost_policy.h"
+#include "extend_stats.h"
 
-typedef double (*COST_FUNC_PTR)(POS2D, POS2D, double**, void*);
+class WorkerPool;
+
+typedef std::chrono::steady_clock PlanningClock;
 
 class RRTNode {
 
@@ -18,7 +30,95 @@ public:
     double   m_cost;
     RRTNode* mp_parent;
     POS2D    m_pos;
-    std::list<RRTNode*> m_child_nodes;
+    unsigned int m_index;
+    // index of its goal connection in the tree, -1 if it has none
+    int      m_goal_connection;
+
+    // children form an intrusive doubly linked sibling list
+    RRTNode* mp_first_child;
+    RRTNode* mp_next_sibling;
+    RRTNode* mp_prev_sibling;
+};
+
+/*
+ * Owns every RRTNode of a tree. Nodes are constructed in place inside
+ * fixed-size contiguous blocks, so their addresses stay valid while the
+ * tree grows and a node can also be referred to by its 32-bit index.
+ */
+class RRTNodeArena {
+
+public:
+    static const unsigned int BLOCK_SHIFT = 12;
+    static const unsigned int BLOCK_SIZE = 1u << BLOCK_SHIFT;
+    static const unsigned int BLOCK_MASK = BLOCK_SIZE - 1;
+
+    class iterator {
+    public:
+        iterator( const RRTNodeArena* p_arena, unsigned int index ) : mp_arena( p_arena ), m_index( index ) {}
+
+        RRTNode* operator*() const { return (*mp_arena)[m_index]; }
+        iterator& operator++() { m_index++; return *this; }
+        iterator operator++(int) { iterator it = *this; m_index++; return it; }
+        bool operator==( const iterator& other ) const { return m_index == other.m_index; }
+        bool operator!=( const iterator& other ) const { return m_index != other.m_index; }
+
+    private:
+        const RRTNodeArena* mp_arena;
+        unsigned int m_index;
+    };
+
+    RRTNodeArena();
+    ~RRTNodeArena();
+
+    RRTNode* create( POS2D pos );
+    // blocks for node_num nodes in all
+    void reserve( unsigned int node_num );
+    void clear();
+
+    unsigned int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    RRTNode* operator[]( unsigned int index ) const { return _blocks[index >> BLOCK_SHIFT] + ( index & BLOCK_MASK ); }
+
+    iterator begin() const { return iterator( this, 0 ); }
+    iterator end() const { return iterator( this, _size ); }
+
+    unsigned int get_block_num() const { return ( _size + BLOCK_MASK ) >> BLOCK_SHIFT; }
+    RRTNode* get_block( unsigned int block_idx ) const { return _blocks[block_idx]; }
+    unsigned int get_block_size( unsigned int block_idx ) const;
+
+private:
+    RRTNodeArena( const RRTNodeArena& other );
+    RRTNodeArena& operator=( const RRTNodeArena& other );
+
+    std::vector<RRTNode*> _blocks;
+    unsigned int _size;
+};
+
+/*
+ * One sample of an extend_n() batch: the result of the read-only phase
+ * (nearest node, steered position, collision verdict) computed against
+ * the tree as it was when the batch started.
+ */
+class ExtendCandidate {
+
+public:
+    ExtendCandidate();
+
+    POS2D    m_rnd_pos;
+    POS2D    m_new_pos;
+    RRTNode* mp_nearest_node;
+    ExtendRejection m_rejection;
+};
+
+/*
+ * Feasibility and cost of the edge between a near node and the new node,
+ * evaluated once by parent selection and reused by rewiring.
+ */
+class EdgeEvaluation {
+
+public:
+    bool   m_obstacle_free;
+    double m_cost;
 };
 
 class Path {
@@ -33,58 +133,151 @@ public:
     std::vector<POS2D> m_way_points;
 };
 
-class RRTstar {
+/*
+ * How the planner keeps the obstacle map. GRAY_MAP keeps the 8-bit gray
+ * values next to the occupancy bits, BIT_MAP only keeps the bits
+ * thresholded at load time. The clearance map, 1 byte per cell, comes
+ * on top in both unless it is disabled. TILED_MAP keeps nothing and reads
+ * the gray values through an attached PagedGrid, for maps that do not fit
+ * in memory; candidates are then prepared without the worker pool.
+ */
+enum MapRepresentation {
+    GRAY_MAP,
+    BIT_MAP,
+    TILED_MAP
+};
 
-public:
-    RRTstar(int width, int height, int segment_length);
-    ~RRTstar();
+/*
+ * The nearest neighbour index of the tree. KDTREE_INDEX is the kdtree++
+ * tree of KDNode2D, which also carry node indices, BUCKET_KDTREE_INDEX a BucketKDTree of node indices.
+ * GRID_INDEX is a GridHashIndex of node indices with cells about the size
+ * of the ball radius, it suits maps small enough for the cells to fit.
+ */
+enum NearIndexType {
+    KDTREE_INDEX,
+    BUCKET_KDTREE_INDEX,
+    GRID_INDEX
+};
 
-    RRTNode* init( POS2D start, POS2D goal, COST_FUNC_PTR p_func, double** pp_cost_distrinution );
+/*
+ * Everything of the planner that does not depend on the edge cost: maps,
+ * sampling, steering, the nearest neighbour index and the tree itself.
+ */
+class RRTstarBase {
 
-    void load_map( int** pp_map );
+public:
+    RRTstarBase(int width, int height, int segment_length, MapRepresentation map_representation = GRAY_MAP);
+    ~RRTstarBase();
+
+    void load_map( GridView<const uint8_t> map );
+    // uses the cells in place (e.g. of a GridFile), they must outlive the planner or the next load
+    void attach_map( GridView<const uint8_t> map );
+    // TILED_MAP only, the map is not owned and must cover the sampling area
+    bool attach_tiled_map( PagedGrid<uint8_t>* p_map );
+    void update_map_info();
+    // with BIT_MAP, or before any map is given, it applies from the next load on
+    void set_obstacle_threshold( int threshold );
+    int get_obstacle_threshold() { return _obstacle_threshold; }
+    void set_clearance_map_enabled( bool enabled );
+    bool get_clearance_map_enabled() { return _clearance_map_enabled; }
 
     int get_sampling_width() { return _sampling_width; }
     int get_sampling_height() { return _sampling_height; }
     int get_current_iteration() { return _current_iteration; }
+    int get_last_propagation_num() { return _last_propagation_num; }
 
-    std::list<RRTNode*>& get_nodes() { return _nodes; }
+    RRTNodeArena& get_nodes() { return _nodes; }
 
-    int**& get_map_info() { return _pp_map_info; }
+    MapRepresentation get_map_representation() { return _map_representation; }
+    // gray values to fill before update_map_info(), a free map when none was given
+    // yet. Empty with BIT_MAP and TILED_MAP or once a map is attached
+    GridView<uint8_t> get_map_info();
     double get_ball_radius() { return _ball_radius; }
 
-    void extend();
-    Path* find_path();
+    // applies from the next init() on
+    void set_near_index_type( NearIndexType type ) { _near_index_type = type; }
+    NearIndexType get_near_index_type() { return _near_index_type; }
+
+    void set_symmetric_cost( bool symmetric ) { _symmetric_cost = symmetric; }
+    bool get_symmetric_cost() { return _symmetric_cost; }
+
+    void set_worker_num( int worker_num );
+    int get_worker_num();
+
+    // after init(), room for node_num nodes in the tree, its index and the
+    // near sets of extend(), which then does not allocate before
+    void reserve( int node_num );
+
+    // nodes within the radius of the goal connect to it, applies to nodes inserted after the call
+    void set_goal_radius( double radius ) { _goal_radius = radius; }
+    double get_goal_radius() { return _goal_radius; }
+    // cost of the best path so far, kept up to date by extend(), max() if none
+    double get_best_cost() { return _best_goal_cost; }
+    bool has_solution() { return _p_best_goal_node != NULL; }
+
+    // plan_until() stops early once the best cost has not dropped by more than
+    // min_improvement (relative) for stall_iteration_num iterations, 0 disables it
+    void set_early_termination( int stall_iteration_num, double min_improvement );
+    int get_stall_iteration_num() { return _stall_iteration_num; }
+    double get_min_improvement() { return _min_improvement; }
+    // whether the last plan_until() stopped on a stalled cost rather than the deadline
+    bool is_stalled() { return _stalled; }
 
     void dump_distribution(std::string filename);
 
+    // zero unless compiled with RRTSTAR_STATS, see extend_stats.h
+    const ExtendStats& get_stats() { return _stats; }
+    void reset_stats() { _stats.reset(); }
+
 protected:
+    RRTNode* _init_tree( POS2D start, POS2D goal, GridView<const double> cost_distribution );
+    void _attach_cost_distribution( GridView<const double> cost_distribution );
+    void _copy_cost_distribution( GridView<const double> cost_distribution );
+    bool _has_map();
+    void _load_blank_map();
+
     POS2D _sampling();
     POS2D _steer( POS2D pos_a, POS2D pos_b );
 
-    KDNode2D _find_nearest( POS2D pos );
-    std::list<KDNode2D> _find_near( POS2D pos );
+    // only writes its arguments, it also runs on the worker threads
+    bool _prepare_extension( POS2D rnd_pos, RRTNode*& p_nearest_node, POS2D& new_pos, ExtendRejection& rejection );
+    // _prepare_extension() on the planner thread, counted in the stats
+    bool _prepare_serial_extension( POS2D rnd_pos, RRTNode*& p_nearest_node, POS2D& new_pos );
+    void _prepare_candidates( int candidate_num );
+    void _prepare_candidate( int candidate_idx );
+
+    double _get_ball_radius( int node_num );
+    // NULL if the tree is empty
+    RRTNode* _find_nearest( POS2D pos );
+    // fills near_indices with the indices of the nodes within the ball radius
+    void _find_near( POS2D pos, std::vector<uint32_t>& near_indices );
 
     bool _is_obstacle_free( POS2D pos_a, POS2D pos_b );
     bool _is_in_obstacle( POS2D pos );
     bool _contains( POS2D pos );
-
-    double _calculate_cost( POS2D& pos_a, POS2D& pos_b );
+    void _insert_into_index( RRTNode* p_node );
 
     RRTNode* _create_new_node( POS2D pos );
     bool _remove_edge( RRTNode* p_node_parent, RRTNode* p_node_child );
     bool _has_edge( RRTNode* p_node_parent, RRTNode* p_node_child );
     bool _add_edge( RRTNode* p_node_parent, RRTNode* p_node_child );
 
-    std::list<RRTNode*> _find_all_children( RRTNode* node );
-
-    void _attach_new_node( RRTNode* p_node_new, RRTNode* p_nearest_node, std::list<RRTNode*> near_nodes );
-    void _rewire_near_nodes( RRTNode* p_node_new, std::list<RRTNode*> near_nodes );
-    void _update_cost_to_children( RRTNode* p_node, double delta_cost );
-    bool _get_closet_to_goal( RRTNode*& p_node_closet_to_goal, double& delta_cost );
+    int _update_cost_to_children( RRTNode* p_node, double delta_cost );
 
     RRTNode* _find_ancestor( RRTNode* p_node );
 
-private:
+    bool _is_in_goal_region( POS2D pos );
+    void _add_goal_connection( RRTNode* p_node, double delta_cost );
+    // after the cost of a node dropped
+    void _update_goal_connection( RRTNode* p_node ) {
+        if( p_node->m_goal_connection >= 0 && p_node->m_cost + _goal_connections[p_node->m_goal_connection] < _best_goal_cost ) {
+            _p_best_goal_node = p_node;
+            _best_goal_cost = p_node->m_cost + _goal_connections[p_node->m_goal_connection];
+        }
+    }
+
+    static void _prepare_candidate_task( int candidate_idx, void* p_tree );
+
     POS2D    _start;
     POS2D    _goal;
     RRTNode* _p_root;
@@ -92,13 +285,50 @@ private:
     int _sampling_width;
     int _sampling_height;
 
-    int** _pp_map_info;
-
+    MapRepresentation _map_representation;
+    int             _obstacle_threshold;
+    // _map_view and _cost_view are the cells in use, either the owned
+    // grids next to them or attached ones
+    Grid<uint8_t>   _map_info;
+    GridView<const uint8_t> _map_view;
+    PagedGrid<uint8_t>* _p_tiled_map;
+    OccupancyBitmap _occupancy_bitmap;
+    ClearanceMap    _clearance_map;
+    bool            _clearance_map_enabled;
+
+    NearIndexType _near_index_type;
+    // the index in use is the one of the last init()
+    NearIndexType _index_type_in_use;
+    // the nodes of the kdtree++ tree come from its pool
+    NodePool*     _p_kd_node_pool;
     KDTree2D*     _p_kd_tree;
-    COST_FUNC_PTR _p_cost_func;
-    double**      _pp_cost_distribution;
-
-    std::list<RRTNode*> _nodes;
+    BucketKDTree  _bucket_kd_tree;
+    GridHashIndex _grid_index;
+    bool          _symmetric_cost;
+    Grid<double>  _cost_distribution;
+    GridView<const double> _cost_view;
+
+    RRTNodeArena _nodes;
+    // scratch buffers reused by every extend() call
+    std::vector<uint32_t> _near_node_indices;
+    std::vector<RRTNode*> _near_rnodes;
+    std::vector<EdgeEvaluation> _near_edges;
+    int _last_propagation_num;
+
+    WorkerPool* _p_worker_pool;
+    std::vector<ExtendCandidate> _candidates;
+    int _batch_size;
+
+    int    _stall_iteration_num;
+    double _min_improvement;
+    bool   _stalled;
+
+    // delta cost to the goal of every node connected to it, the node of the
+    // cheapest total cost is tracked as costs drop
+    double _goal_radius;
+    std::vector<double> _goal_connections;
+    RRTNode* _p_best_goal_node;
+    double   _best_goal_cost;
 
     double _range;
     double _ball_radius;
@@ -107,8 +337,76 @@ private:
 
     double _theta;
     int    _current_iteration;
+
+    ExtendStats _stats;
+
+private:
+    RRTstarBase( const RRTstarBase& other );
+    RRTstarBase& operator=( const RRTstarBase& other );
 };
 
+/*
+ * The planner, with the edge cost given by the policy COST (see
+ * cost_policy.h) so that it is compiled into parent selection and
+ * rewiring instead of being called through a pointer.
+ */
+template <class COST>
+class RRTstarT : public RRTstarBase {
+
+public:
+    RRTstarT(int width, int height, int segment_length, MapRepresentation map_representation = GRAY_MAP)
+        : RRTstarBase( width, height, segment_length, map_representation ) {}
+
+    // an empty cost distribution means none, also after attach_cost_distribution().
+    // One of another size than the map is cropped or padded with 0
+    RRTNode* init( POS2D start, POS2D goal, GridView<const double> cost_distribution = GridView<const double>() );
+    // only for FuncPtrCost
+    RRTNode* init( POS2D start, POS2D goal, COST_FUNC_PTR p_func,
+                   GridView<const double> cost_distribution = GridView<const double>() );
+    // like init() but the distribution is attached as by attach_cost_distribution()
+    RRTNode* init_attached( POS2D start, POS2D goal, GridView<const double> cost_distribution );
+    // like the distribution of init() but used in place when it has the size of the map,
+    // it must then outlive the planner or the next init(). Edges already in the tree keep
+    // their costs, init_attached() also costs the goal connection of the root with it
+    void attach_cost_distribution( GridView<const double> cost_distribution );
+
+    COST& get_cost_policy() { return _cost_policy; }
+
+    // one sample, false if it added no node
+    bool try_extend();
+    // samples until a node is added, which never ends when no sample can be
+    void extend();
+    void extend_n( int k );
+    Path* find_path();
+
+    /*
+     * Anytime planning: samples until the deadline and returns the best
+     * path so far. No try_extend() is started that would end past the
+     * deadline if it took as long as the slowest recent one, so the call
+     * overruns only on an outlier sample, also when no sample adds a node.
+     */
+    Path* plan_until( PlanningClock::time_point deadline );
+    Path* plan_for( double seconds );
+
+protected:
+    bool _commit_candidate( ExtendCandidate& candidate );
+    void _insert_new_node( POS2D new_pos, RRTNode* p_nearest_rnode );
+
+    bool _evaluate_edge( POS2D& pos_a, POS2D& pos_b, double& cost );
+    double _calculate_cost( POS2D& pos_a, POS2D& pos_b ) { return _cost_policy.cost( pos_a, pos_b ); }
+
+    void _attach_new_node( RRTNode* p_node_new, RRTNode* p_nearest_node, const std::vector<RRTNode*>& near_nodes,
+                           std::vector<EdgeEvaluation>& near_edges );
+    void _rewire_near_nodes( RRTNode* p_node_new, const std::vector<RRTNode*>& near_nodes,
+                             const std::vector<EdgeEvaluation>& near_edges );
+    void _connect_to_goal( RRTNode* p_node );
+
+private:
+    COST _cost_policy;
+};
+
+typedef RRTstarT<FuncPtrCost> RRTstar;
+
 inline RRTNode* get_ancestor( RRTNode * node ) {
     if( NULL == node ) {
         return NULL;
@@ -130,4 +428,9 @@ inline void get_parent_node_list( RRTNode * node, std::list<RRTNode*>& path ) {
     return;
 }
 
+#include "rrtstar_impl.h"
+
+// instantiated once in rrtstar.cpp
+extern template class RRTstarT<FuncPtrCost>;
+
 #endif // RRTSTAR_H
@@ -0,0 +1,296 @@
+#ifndef RRTSTAR_IMPL_H
+#define RRTSTAR_IMPL_H
+
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+// member definitions of RRTstarT, included at the end of rrtstar.h
+
+template <class COST>
+RRTNode* RRTstarT<COST>::init( POS2D start, POS2D goal, GridView<const double> cost_distribution ) {
+    RRTNode* p_root = _init_tree( start, goal, cost_distribution );
+    _cost_policy.bind( _cost_view, this );
+    _connect_to_goal( p_root );
+    return p_root;
+}
+
+template <class COST>
+RRTNode* RRTstarT<COST>::init( POS2D start, POS2D goal, COST_FUNC_PTR p_func, GridView<const double> cost_distribution ) {
+    _cost_policy.set_func( p_func );
+    return init( start, goal, cost_distribution );
+}
+
+template <class COST>
+RRTNode* RRTstarT<COST>::init_attached( POS2D start, POS2D goal, GridView<const double> cost_distribution ) {
+    RRTNode* p_root = _init_tree( start, goal, GridView<const double>() );
+    _attach_cost_distribution( cost_distribution );
+    _cost_policy.bind( _cost_view, this );
+    _connect_to_goal( p_root );
+    return p_root;
+}
+
+template <class COST>
+void RRTstarT<COST>::attach_cost_distribution( GridView<const double> cost_distribution ) {
+    _attach_cost_distribution( cost_distribution );
+    _cost_policy.bind( _cost_view, this );
+}
+
+template <class COST>
+bool RRTstarT<COST>::_evaluate_edge( POS2D& pos_a, POS2D& pos_b, double& cost ) {
+    // the cost needs a full walk anyway, the obstacle check rides along
+    // unless the clearance map already proves the segment free; a paged
+    // map has no occupancy bits to fuse with
+    if( _map_representation != TILED_MAP && _cost_policy.integrates_field() ) {
+        if( false == _clearance_map.empty() && true == _clearance_map.covers_segment( pos_a, pos_b ) ) {
+            cost = integrate_cost_field( pos_a, pos_b, _cost_view );
+            return true;
+        }
+        return trace_cost_field( pos_a, pos_b, _cost_view, _occupancy_bitmap, cost );
+    }
+
+    cost = 0.0;
+    if( false == _is_obstacle_free( pos_a, pos_b ) ) {
+        return false;
+    }
+    cost = _calculate_cost( pos_a, pos_b );
+    return true;
+}
+
+template <class COST>
+void RRTstarT<COST>::_insert_new_node( POS2D new_pos, RRTNode* p_nearest_rnode ) {
+    {
+        RRTSTAR_STATS_TIMER( PHASE_NEAR );
+        _find_near( new_pos, _near_node_indices );
+    }
+    RRTSTAR_STATS_ADD( m_near_query_num, 1 );
+    RRTSTAR_STATS_ADD( m_near_node_num, _near_node_indices.size() );
+    RRTSTAR_STATS_MAX( m_max_near_node_num, _near_node_indices.size() );
+
+    RRTNode * p_new_rnode = NULL;
+    {
+        RRTSTAR_STATS_TIMER( PHASE_INSERT );
+        // create new node
+        p_new_rnode = _create_new_node( new_pos );
+        _insert_into_index( p_new_rnode );
+
+        _near_rnodes.clear();
+        for( unsigned int i=0; i<_near_node_indices.size(); i++ ) {
+            _near_rnodes.push_back( _nodes[_near_node_indices[i]] );
+        }
+    }
+
+    // attach new node to reference trees
+    _attach_new_node( p_new_rnode, p_nearest_rnode, _near_rnodes, _near_edges );
+    if( p_new_rnode->mp_parent ) {
+        _connect_to_goal( p_new_rnode );
+    }
+    // rewire near nodes of reference trees
+    _rewire_near_nodes( p_new_rnode, _near_rnodes, _near_edges );
+}
+
+template <class COST>
+bool RRTstarT<COST>::try_extend() {
+    _last_propagation_num = 0;
+    POS2D rnd_pos = _sampling();
+    RRTNode* p_nearest_node = NULL;
+    POS2D new_pos;
+
+    RRTSTAR_STATS_ADD( m_sample_num, 1 );
+    if( false == _prepare_serial_extension( rnd_pos, p_nearest_node, new_pos ) ) {
+        return false;
+    }
+    _insert_new_node( new_pos, p_nearest_node );
+    _current_iteration++;
+    return true;
+}
+
+template <class COST>
+void RRTstarT<COST>::extend() {
+    while( false == try_extend() ) {
+    }
+}
+
+template <class COST>
+void RRTstarT<COST>::extend_n( int k ) {
+    _last_propagation_num = 0;
+    int inserted_num = 0;
+    while( inserted_num < k ) {
+        int candidate_num = k - inserted_num;
+        if( candidate_num > _batch_size ) {
+            candidate_num = _batch_size;
+        }
+
+        _prepare_candidates( candidate_num );
+
+        for( int i=0; i<candidate_num && inserted_num<k; i++ ) {
+            if( true == _commit_candidate( _candidates[i] ) ) {
+                inserted_num++;
+                _current_iteration++;
+            }
+        }
+    }
+}
+
+template <class COST>
+bool RRTstarT<COST>::_commit_candidate( ExtendCandidate& candidate ) {
+    // earlier commits of the batch may have grown the tree closer to the sample,
+    // the speculative result is only reused while its nearest node is still the nearest
+    RRTNode* p_nearest_node = _find_nearest( candidate.m_rnd_pos );
+    POS2D new_pos = candidate.m_new_pos;
+    if( p_nearest_node == candidate.mp_nearest_node ) {
+        ExtendRejection rejection = candidate.m_rejection;
+        if( rejection == EXTEND_ACCEPTED && true == _contains( new_pos ) ) {
+            rejection = REJECT_CONTAINED;
+        }
+        RRTSTAR_STATS_ADD( m_extension_num[rejection], 1 );
+        if( rejection != EXTEND_ACCEPTED ) {
+            return false;
+        }
+    }
+    else {
+        RRTSTAR_STATS_ADD( m_stale_candidate_num, 1 );
+        if( false == _prepare_serial_extension( candidate.m_rnd_pos, p_nearest_node, new_pos ) ) {
+            return false;
+        }
+    }
+
+    _insert_new_node( new_pos, p_nearest_node );
+    return true;
+}
+
+template <class COST>
+Path* RRTstarT<COST>::find_path() {
+    Path* p_new_path = new Path( _start, _goal );
+
+    if( _p_best_goal_node != NULL ) {
+        for( RRTNode* p_node = _p_best_goal_node; p_node != NULL; p_node = p_node->mp_parent ) {
+            p_new_path->m_way_points.push_back( p_node->m_pos );
+        }
+        std::reverse( p_new_path->m_way_points.begin(), p_new_path->m_way_points.end() );
+        p_new_path->m_way_points.push_back(_goal);
+
+        p_new_path->m_cost = _best_goal_cost;
+    }
+
+    return p_new_path;
+}
+
+template <class COST>
+Path* RRTstarT<COST>::plan_until( PlanningClock::time_point deadline ) {
+    _stalled = false;
+    double best_cost = std::numeric_limits<double>::max();
+    int improved_iteration = _current_iteration;
+
+    // the slowest recent try_extend(), decaying by 1/8 per sample
+    PlanningClock::time_point now = PlanningClock::now();
+    PlanningClock::duration extend_time = PlanningClock::duration::zero();
+    while( now + extend_time < deadline ) {
+        bool inserted = try_extend();
+        PlanningClock::time_point extend_end = PlanningClock::now();
+        extend_time = std::max( extend_end - now, extend_time - extend_time / 8 );
+        now = extend_end;
+
+        if( true == inserted && _stall_iteration_num > 0 ) {
+            if( _best_goal_cost < best_cost * ( 1.0 - _min_improvement ) || NULL == _p_best_goal_node ) {
+                // nothing to stall on before the goal is reached
+                best_cost = _best_goal_cost;
+                improved_iteration = _current_iteration;
+            }
+            else if( _current_iteration - improved_iteration >= _stall_iteration_num ) {
+                _stalled = true;
+                break;
+            }
+        }
+    }
+    return find_path();
+}
+
+template <class COST>
+Path* RRTstarT<COST>::plan_for( double seconds ) {
+    PlanningClock::duration budget = std::chrono::duration_cast<PlanningClock::duration>( std::chrono::duration<double>( seconds ) );
+    return plan_until( PlanningClock::now() + budget );
+}
+
+template <class COST>
+void RRTstarT<COST>::_attach_new_node(RRTNode* p_node_new, RRTNode* p_nearest_node, const std::vector<RRTNode*>& near_nodes,
+                                      std::vector<EdgeEvaluation>& near_edges) {
+    RRTSTAR_STATS_TIMER( PHASE_ATTACH );
+    RRTSTAR_STATS_ADD( m_edge_evaluation_num, near_nodes.size() );
+    double min_new_node_cost = p_nearest_node->m_cost + _calculate_cost(p_nearest_node->m_pos, p_node_new->m_pos);
+    RRTNode* p_min_node = p_nearest_node;
+
+    near_edges.resize( near_nodes.size() );
+    for(unsigned int i=0;i<near_nodes.size();i++) {
+        RRTNode* p_near_node = near_nodes[i];
+        EdgeEvaluation& edge = near_edges[i];
+        edge.m_obstacle_free = _evaluate_edge( p_near_node->m_pos, p_node_new->m_pos, edge.m_cost );
+        if ( true == edge.m_obstacle_free ) {
+            double new_cost = p_near_node->m_cost + edge.m_cost;
+            if ( new_cost < min_new_node_cost ) {
+                p_min_node = p_near_node;
+                min_new_node_cost = new_cost;
+            }
+        }
+    }
+
+    bool added = _add_edge( p_min_node, p_node_new );
+    if( added ) {
+        p_node_new->m_cost = min_new_node_cost;
+    }
+
+}
+
+template <class COST>
+void RRTstarT<COST>::_rewire_near_nodes(RRTNode* p_node_new, const std::vector<RRTNode*>& near_nodes,
+                                        const std::vector<EdgeEvaluation>& near_edges) {
+    RRTSTAR_STATS_TIMER( PHASE_REWIRE );
+    for( unsigned int i=0; i<near_nodes.size(); i++ ) {
+        RRTNode * p_near_node = near_nodes[i];
+
+        if(p_near_node->m_pos ==p_node_new->m_pos ||  p_near_node->m_pos==_p_root->m_pos || p_node_new->mp_parent->m_pos==p_near_node->m_pos) {
+            continue;
+        }
+
+        // the segment check is symmetric, the cost only when the cost function says so
+        if( true == near_edges[i].m_obstacle_free ) {
+            double temp_delta_cost = near_edges[i].m_cost;
+            if( false == _symmetric_cost ) {
+                temp_delta_cost = _calculate_cost( p_node_new->m_pos, p_near_node->m_pos );
+            }
+            double temp_cost_from_new_node = p_node_new->m_cost + temp_delta_cost;
+            if( temp_cost_from_new_node < p_near_node->m_cost ) {
+                double min_delta_cost = p_near_node->m_cost - temp_cost_from_new_node;
+                RRTNode * p_parent_node = p_near_node->mp_parent;
+                bool removed = _remove_edge(p_parent_node, p_near_node);
+                if(removed) {
+                    bool added = _add_edge(p_node_new, p_near_node);
+                    if( added ) {
+                        p_near_node->m_cost = temp_cost_from_new_node;
+                        _update_goal_connection( p_near_node );
+                        int propagation_num = _update_cost_to_children(p_near_node, min_delta_cost);
+                        _last_propagation_num += propagation_num;
+                        RRTSTAR_STATS_ADD( m_rewire_num, 1 );
+                        RRTSTAR_STATS_ADD( m_propagation_num, propagation_num );
+                    }
+                }
+                else {
+                    std::cout << " Failed in removing " << std::endl;
+                }
+            }
+        }
+    }
+}
+
+template <class COST>
+void RRTstarT<COST>::_connect_to_goal( RRTNode* p_node ) {
+    if( false == _is_in_goal_region( p_node->m_pos ) ) {
+        return;
+    }
+    double delta_cost = 0.0;
+    if( true == _evaluate_edge( p_node->m_pos, _goal, delta_cost ) ) {
+        _add_goal_connection( p_node, delta_cost );
+    }
+}
+
+#endif // RRTSTAR_IMPL_H
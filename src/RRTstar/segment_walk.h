@@ -0,0 +1,76 @@
+#ifndef SEGMENT_WALK_H
+#define SEGMENT_WALK_H
+
+#include <cstdlib>
+#include <algorithm>
+
+#include "KDTree2D.h"
+
+/*
+ * Visits the Bresenham cells between pos_a and pos_b that lie inside a
+ * width x height map, in the order shared by every segment walk of the
+ * planner: from the endpoint with the smaller major coordinate, with the
+ * other endpoint excluded. visitor( x, y ) returns false to stop early,
+ * in which case walk_segment() returns false as well.
+ */
+template <class CellVisitor>
+inline bool walk_segment( POS2D pos_a, POS2D pos_b, int width, int height, CellVisitor& visitor ) {
+    if ( pos_a == pos_b ) {
+        return true;
+    }
+
+    int x1 = pos_a[0];
+    int y1 = pos_a[1];
+    int x2 = pos_b[0];
+    int y2 = pos_b[1];
+
+    const bool steep = ( abs(y2 - y1) > abs(x2 - x1) );
+    if ( steep ) {
+        std::swap( x1, y1 );
+        std::swap( x2, y2 );
+    }
+    if ( x1 > x2 ) {
+        std::swap( x1, x2 );
+        std::swap( y1, y2 );
+    }
+
+    const long dx = x2 - x1;
+    const long dy = abs( y2 - y1 );
+    const int ystep = (y1 < y2) ? 1 : -1;
+
+    // error term doubled so that it stays integral, the minor step is
+    // applied through a sign mask to keep the loop free of unpredictable branches
+    long error = dx;
+    int y = y1;
+    const int maxX = x2;
+
+    if( steep ) {
+        for( int x=x1; x<maxX; x++ ) {
+            if( (unsigned int)y < (unsigned int)width && (unsigned int)x < (unsigned int)height ) {
+                if( false == visitor( y, x ) ) {
+                    return false;
+                }
+            }
+            error -= 2 * dy;
+            const long carry = error >> ( sizeof(long) * 8 - 1 );
+            y += ystep & carry;
+            error += ( 2 * dx ) & carry;
+        }
+    }
+    else {
+        for( int x=x1; x<maxX; x++ ) {
+            if( (unsigned int)x < (unsigned int)width && (unsigned int)y < (unsigned int)height ) {
+                if( false == visitor( x, y ) ) {
+                    return false;
+                }
+            }
+            error -= 2 * dy;
+            const long carry = error >> ( sizeof(long) * 8 - 1 );
+            y += ystep & carry;
+            error += ( 2 * dx ) & carry;
+        }
+    }
+    return true;
+}
+
+#endif // SEGMENT_WALK_H
@@ -0,0 +1,88 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool( int worker_num ) {
+    _p_task = NULL;
+    _p_data = NULL;
+    _task_num = 0;
+    _next_task = 0;
+    _busy_num = 0;
+    _generation = 0;
+    _stopping = false;
+
+    for( int i=0; i<worker_num; i++ ) {
+        _threads.push_back( std::thread( &WorkerPool::_work_loop, this ) );
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::unique_lock<std::mutex> lock( _mutex );
+        _stopping = true;
+    }
+    _start_cond.notify_all();
+    for( unsigned int i=0; i<_threads.size(); i++ ) {
+        _threads[i].join();
+    }
+}
+
+void WorkerPool::run( int task_num, WORKER_TASK_PTR p_task, void* p_data ) {
+    if( task_num <= 0 ) {
+        return;
+    }
+    if( _threads.empty() ) {
+        for( int i=0; i<task_num; i++ ) {
+            p_task( i, p_data );
+        }
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock( _mutex );
+        _p_task = p_task;
+        _p_data = p_data;
+        _task_num = task_num;
+        _next_task = 0;
+        _busy_num = (int)_threads.size();
+        _generation++;
+    }
+    _start_cond.notify_all();
+
+    _run_tasks();
+
+    std::unique_lock<std::mutex> lock( _mutex );
+    while( _busy_num > 0 ) {
+        _done_cond.wait( lock );
+    }
+}
+
+void WorkerPool::_run_tasks() {
+    int task_idx = _next_task++;
+    while( task_idx < _task_num ) {
+        _p_task( task_idx, _p_data );
+        task_idx = _next_task++;
+    }
+}
+
+void WorkerPool::_work_loop() {
+    unsigned int seen_generation = 0;
+    while( true ) {
+        {
+            std::unique_lock<std::mutex> lock( _mutex );
+            while( false == _stopping && seen_generation == _generation ) {
+                _start_cond.wait( lock );
+            }
+            if( _stopping ) {
+                return;
+            }
+            seen_generation = _generation;
+        }
+
+        _run_tasks();
+
+        std::unique_lock<std::mutex> lock( _mutex );
+        _busy_num--;
+        if( _busy_num == 0 ) {
+            _done_cond.notify_one();
+        }
+    }
+}
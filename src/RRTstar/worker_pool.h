@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+typedef void (*WORKER_TASK_PTR)( int task_idx, void* p_data );
+
+/*
+ * A fixed set of threads that run one parallel-for at a time.
+ * run() hands out task indices [0, task_num) to the workers and the
+ * calling thread, and returns once every task has finished.
+ */
+class WorkerPool {
+
+public:
+    WorkerPool( int worker_num );
+    ~WorkerPool();
+
+    int get_worker_num() const { return (int)_threads.size(); }
+
+    void run( int task_num, WORKER_TASK_PTR p_task, void* p_data );
+
+private:
+    WorkerPool( const WorkerPool& other );
+    WorkerPool& operator=( const WorkerPool& other );
+
+    void _work_loop();
+    void _run_tasks();
+
+    std::vector<std::thread> _threads;
+    std::mutex               _mutex;
+    std::condition_variable  _start_cond;
+    std::condition_variable  _done_cond;
+
+    WORKER_TASK_PTR  _p_task;
+    void*            _p_data;
+    int              _task_num;
+    std::atomic<int> _next_task;
+    int              _busy_num;
+    unsigned int     _generation;
+    bool             _stopping;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,502 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+#include <malloc.h>
+
+#include "rrtstar.h"
+#include "cost_field.h"
+#include "gray_image.h"
+
+/*
+ * Fixed-seed benchmarks of the planner's hot kernels. Each scenario grows
+ * a tree through the node count checkpoints and, at every checkpoint,
+ * times extend() since the previous one and a fixed number of calls of
+ * each kernel. Results go to stdout as one JSON object per line.
+ *
+ * The near set of extend() grows with the tree, so the default stops at
+ * 100k nodes; -n 1000000 also runs the 1M checkpoint of the large map.
+ *
+ * The index scenarios time each NearIndexType on its own, filled with
+ * uniform random points up to 1M, with the ball radius the planner would
+ * use at that size. Both indices answer the same queries, a difference
+ * in the results is reported on stderr. The bucket KD-tree is also filled
+ * in x order, which it has to rebalance all the time.
+ */
+
+#ifndef RRTSTAR_DATA_DIR
+#define RRTSTAR_DATA_DIR "data"
+#endif
+
+// makes the protected kernels callable from the benchmark
+template <class COST>
+class BenchPlanner : public RRTstarT<COST> {
+
+public:
+    BenchPlanner(int width, int height, int segment_length) : RRTstarT<COST>( width, height, segment_length ) {}
+
+    RRTNode* find_nearest( POS2D pos ) { return this->_find_nearest( pos ); }
+    void find_near( POS2D pos, std::vector<uint32_t>& near_indices ) { this->_find_near( pos, near_indices ); }
+    bool is_obstacle_free( POS2D pos_a, POS2D pos_b ) { return this->_is_obstacle_free( pos_a, pos_b ); }
+    GridView<const double> get_cost_view() { return this->_cost_view; }
+    int get_index_depth() { return this->_bucket_kd_tree.get_depth(); }
+};
+
+class BenchOptions {
+public:
+    BenchOptions() : m_data_dir( RRTSTAR_DATA_DIR ), m_max_node_num( 100000 ), m_query_num( 10000 ), m_seed( 1 ) {}
+
+    std::string m_data_dir;
+    int m_max_node_num;
+    int m_query_num;
+    int m_seed;
+};
+
+class Scenario {
+public:
+    std::string m_name;
+    Grid<uint8_t> m_map;
+    Grid<double>  m_cost_distribution;
+    POS2D m_start;
+    POS2D m_goal;
+    int   m_segment_length;
+};
+
+static const int CHECKPOINTS[] = { 10000, 100000, 1000000 };
+static const int CHECKPOINT_NUM = sizeof(CHECKPOINTS) / sizeof(CHECKPOINTS[0]);
+
+static double get_seconds_since( std::chrono::steady_clock::time_point begin ) {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+}
+
+static long get_resident_bytes() {
+    long pages = 0, resident_pages = 0;
+    FILE* p_file = fopen( "/proc/self/statm", "r" );
+    if( p_file == NULL ) {
+        return 0;
+    }
+    if( fscanf( p_file, "%ld %ld", &pages, &resident_pages ) != 2 ) {
+        resident_pages = 0;
+    }
+    fclose( p_file );
+    return resident_pages * sysconf( _SC_PAGESIZE );
+}
+
+// heap bytes in use, unlike the resident size it does not depend on what earlier scenarios freed
+static long get_heap_bytes() {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// the radius of _find_near() for a tree of node_num nodes
+static double get_ball_radius( int width, int height, int node_num ) {
+    double range = std::max( width, height );
+    return 10.0 * range * sqrt( log( node_num + 1.0 ) / ( node_num + 1.0 ) );
+}
+
+static void print_result( const std::string& name, const char* kernel, int node_num, long op_num, double seconds ) {
+    printf( "{\"scenario\":\"%s\",\"kernel\":\"%s\",\"nodes\":%d,\"ops\":%ld,\"seconds\":%.6f,\"ns_per_op\":%.1f,\"ops_per_second\":%.1f}\n",
+            name.c_str(), kernel, node_num, op_num, seconds,
+            op_num > 0 ? seconds * 1e9 / op_num : 0.0, seconds > 0.0 ? op_num / seconds : 0.0 );
+}
+
+// rectangles of random size at random places, the same for a given seed
+static void make_block_map( Grid<uint8_t>& map, int width, int height, int block_num, int seed ) {
+    map.resize( width, height, 255 );
+    srand( seed );
+    for( int k=0; k<block_num; k++ ) {
+        int block_width = 5 + rand() % ( width / 20 );
+        int block_height = 5 + rand() % ( height / 20 );
+        int x0 = rand() % ( width - block_width );
+        int y0 = rand() % ( height - block_height );
+        for( int j=y0; j<y0+block_height; j++ ) {
+            uint8_t* p_row = map.get_row( j );
+            std::fill( p_row + x0, p_row + x0 + block_width, 0 );
+        }
+    }
+}
+
+static void clear_around( Grid<uint8_t>& map, POS2D pos, int radius ) {
+    for( int j=pos[1]-radius; j<=pos[1]+radius; j++ ) {
+        for( int i=pos[0]-radius; i<=pos[0]+radius; i++ ) {
+            if( map.contains( i, j ) ) {
+                map( i, j ) = 255;
+            }
+        }
+    }
+}
+
+// nodes sit on distinct integer cells, half of the free cells is as far as extend() gets in reasonable time
+static long get_free_cell_num( const Grid<uint8_t>& map ) {
+    long free_cell_num = 0;
+    for( int j=0; j<map.get_height(); j++ ) {
+        const uint8_t* p_row = map.get_row( j );
+        for( int i=0; i<map.get_width(); i++ ) {
+            free_cell_num += ( p_row[i] == 255 ) ? 1 : 0;
+        }
+    }
+    return free_cell_num;
+}
+
+template <class COST>
+static void run_scenario( const Scenario& scenario, const BenchOptions& options ) {
+    int width = scenario.m_map.get_width();
+    int height = scenario.m_map.get_height();
+    long free_cell_num = get_free_cell_num( scenario.m_map );
+
+    srand( options.m_seed );
+    BenchPlanner<COST> planner( width, height, scenario.m_segment_length );
+    planner.attach_map( scenario.m_map );
+    planner.init_attached( scenario.m_start, scenario.m_goal, scenario.m_cost_distribution );
+    long base_heap_bytes = get_heap_bytes();
+
+    std::vector<uint32_t> near_list;
+    double checksum = 0.0;
+    for( int c=0; c<CHECKPOINT_NUM; c++ ) {
+        int node_num = CHECKPOINTS[c];
+        if( node_num > options.m_max_node_num || node_num > free_cell_num / 2 ) {
+            break;
+        }
+
+        int extend_num = node_num - (int)planner.get_nodes().size();
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for( int i=0; i<extend_num; i++ ) {
+            planner.extend();
+        }
+        print_result( scenario.m_name, "extend", node_num, extend_num, get_seconds_since( begin ) );
+
+        Path* p_path = planner.find_path();
+        printf( "{\"scenario\":\"%s\",\"kernel\":\"memory\",\"nodes\":%d,\"resident_bytes\":%ld,\"tree_heap_bytes\":%ld,\"index_depth\":%d,\"path_cost\":%.6f}\n",
+                scenario.m_name.c_str(), node_num, get_resident_bytes(), get_heap_bytes() - base_heap_bytes, planner.get_index_depth(), p_path->m_cost );
+        delete p_path;
+
+        // queries are drawn up front so that rand() is not timed
+        std::vector<POS2D> queries( options.m_query_num );
+        std::vector<POS2D> ends( options.m_query_num );
+        for( int i=0; i<options.m_query_num; i++ ) {
+            queries[i] = POS2D( rand() % width, rand() % height );
+            int dx = rand() % ( 2 * scenario.m_segment_length + 1 ) - scenario.m_segment_length;
+            int dy = rand() % ( 2 * scenario.m_segment_length + 1 ) - scenario.m_segment_length;
+            ends[i] = POS2D( std::min( std::max( queries[i][0] + dx, 0 ), width - 1 ),
+                             std::min( std::max( queries[i][1] + dy, 0 ), height - 1 ) );
+        }
+
+        begin = std::chrono::steady_clock::now();
+        for( int i=0; i<options.m_query_num; i++ ) {
+            checksum += planner.find_nearest( queries[i] )->m_pos.d[0];
+        }
+        print_result( scenario.m_name, "find_nearest", node_num, options.m_query_num, get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( int i=0; i<options.m_query_num; i++ ) {
+            planner.find_near( queries[i], near_list );
+            checksum += near_list.size();
+        }
+        print_result( scenario.m_name, "find_near", node_num, options.m_query_num, get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( int i=0; i<options.m_query_num; i++ ) {
+            checksum += planner.is_obstacle_free( queries[i], ends[i] ) ? 1 : 0;
+        }
+        print_result( scenario.m_name, "is_obstacle_free", node_num, options.m_query_num, get_seconds_since( begin ) );
+
+        GridView<const double> cost_view = planner.get_cost_view();
+        if( false == cost_view.empty() ) {
+            begin = std::chrono::steady_clock::now();
+            for( int i=0; i<options.m_query_num; i++ ) {
+                checksum += calc_field_cost( queries[i], ends[i], cost_view, &planner );
+            }
+            print_result( scenario.m_name, "calc_cost", node_num, options.m_query_num, get_seconds_since( begin ) );
+        }
+    }
+    // keeps the kernel results alive
+    fprintf( stderr, "%s checksum %f\n", scenario.m_name.c_str(), checksum );
+}
+
+// what one index answered, to compare the indices with each other
+class IndexResults {
+public:
+    std::vector<double> m_nearest_dist;
+    std::vector<unsigned int> m_near_num;
+    long m_contained_num;
+};
+
+// with p_pool the nodes come from it as in the planner, otherwise from the heap
+static void run_kdtree_index( const std::string& name, NodePool* p_pool, const std::vector<POS2D>& points,
+                              const std::vector<POS2D>& queries, int width, int height, IndexResults& results ) {
+    KDTree2D tree( p_pool );
+    std::vector<uint32_t> near_list;
+    unsigned int inserted_num = 0;
+    for( int c=0; c<CHECKPOINT_NUM && CHECKPOINTS[c] <= (int)points.size(); c++ ) {
+        int node_num = CHECKPOINTS[c];
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for( ; inserted_num < (unsigned int)node_num; inserted_num++ ) {
+            KDNode2D node( points[inserted_num].d[0], points[inserted_num].d[1] );
+            node.setNodeIndex( inserted_num );
+            tree.insert( node );
+        }
+        print_result( name, "insert", node_num, node_num - ( c > 0 ? CHECKPOINTS[c-1] : 0 ), get_seconds_since( begin ) );
+
+        double radius = get_ball_radius( width, height, node_num );
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            KDNode2D node( queries[i].d[0], queries[i].d[1] );
+            results.m_nearest_dist.push_back( tree.find_nearest( node ).second );
+        }
+        print_result( name, "find_nearest", node_num, queries.size(), get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            near_list.clear();
+            tree.find_within_radius( queries[i], radius, near_list );
+            results.m_near_num.push_back( near_list.size() );
+        }
+        print_result( name, "find_near", node_num, queries.size(), get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            KDNode2D node( queries[i].d[0], queries[i].d[1] );
+            results.m_contained_num += ( tree.find( node ) != tree.end() ) ? 1 : 0;
+        }
+        print_result( name, "contains", node_num, queries.size(), get_seconds_since( begin ) );
+    }
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int node_num = tree.size();
+    if( p_pool ) {
+        tree.release_nodes();
+        p_pool->reset();
+    }
+    else {
+        tree.clear();
+    }
+    print_result( name, "release", node_num, node_num, get_seconds_since( begin ) );
+}
+
+// the planner keeps the grid cells at about the ball radius
+static void fit_index( BucketKDTree& tree, double radius ) {}
+static void fit_index( GridHashIndex& index, double radius ) { index.set_radius( radius ); }
+
+static void print_index_shape( const std::string& name, int node_num, const BucketKDTree& tree ) {
+    printf( "{\"scenario\":\"%s\",\"kernel\":\"shape\",\"nodes\":%d,\"depth\":%d,\"rebuilt_points\":%ld}\n",
+            name.c_str(), node_num, tree.get_depth(), tree.get_rebuilt_point_num() );
+}
+
+static void print_index_shape( const std::string& name, int node_num, const GridHashIndex& index ) {
+    printf( "{\"scenario\":\"%s\",\"kernel\":\"shape\",\"nodes\":%d,\"cell_size\":%d,\"rebuilds\":%ld}\n",
+            name.c_str(), node_num, index.get_cell_size(), index.get_rebuild_num() );
+}
+
+// for the indices of node indices, the payloads are indices into points
+template <class INDEX>
+static void run_index( const std::string& name, INDEX& tree, const std::vector<POS2D>& points, const std::vector<POS2D>& queries,
+                       int width, int height, IndexResults& results ) {
+    std::vector<uint32_t> near_list;
+    unsigned int inserted_num = 0;
+    for( int c=0; c<CHECKPOINT_NUM && CHECKPOINTS[c] <= (int)points.size(); c++ ) {
+        int node_num = CHECKPOINTS[c];
+        double radius = get_ball_radius( width, height, node_num );
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for( ; inserted_num < (unsigned int)node_num; inserted_num++ ) {
+            tree.insert( points[inserted_num], inserted_num );
+        }
+        fit_index( tree, radius );
+        print_result( name, "insert", node_num, node_num - ( c > 0 ? CHECKPOINTS[c-1] : 0 ), get_seconds_since( begin ) );
+        print_index_shape( name, node_num, tree );
+
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            uint32_t point_idx = 0;
+            tree.find_nearest( queries[i], point_idx );
+            results.m_nearest_dist.push_back( queries[i].distance_to( points[point_idx] ) );
+        }
+        print_result( name, "find_nearest", node_num, queries.size(), get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            near_list.clear();
+            tree.find_within_radius( queries[i], radius, near_list );
+            results.m_near_num.push_back( near_list.size() );
+        }
+        print_result( name, "find_near", node_num, queries.size(), get_seconds_since( begin ) );
+
+        begin = std::chrono::steady_clock::now();
+        for( unsigned int i=0; i<queries.size(); i++ ) {
+            results.m_contained_num += tree.contains( queries[i] ) ? 1 : 0;
+        }
+        print_result( name, "contains", node_num, queries.size(), get_seconds_since( begin ) );
+    }
+}
+
+static bool is_lower_in_x( const POS2D& a, const POS2D& b ) {
+    return a.d[0] < b.d[0] || ( a.d[0] == b.d[0] && a.d[1] < b.d[1] );
+}
+
+static void run_index_scenarios( const BenchOptions& options ) {
+    const int width = 3000;
+    const int height = 3000;
+    // distinct points, as the planner never inserts a position twice
+    srand( options.m_seed );
+    std::vector<bool> occupied( width * height, false );
+    std::vector<POS2D> points;
+    while( points.size() < (unsigned int)CHECKPOINTS[CHECKPOINT_NUM-1] ) {
+        POS2D pos( rand() % width, rand() % height );
+        if( false == occupied[pos[1] * width + pos[0]] ) {
+            occupied[pos[1] * width + pos[0]] = true;
+            points.push_back( pos );
+        }
+    }
+    std::vector<POS2D> queries( options.m_query_num );
+    for( int i=0; i<options.m_query_num; i++ ) {
+        queries[i] = POS2D( rand() % width, rand() % height );
+    }
+
+    IndexResults kdtree_results;
+    kdtree_results.m_contained_num = 0;
+    run_kdtree_index( "index_kdtree", NULL, points, queries, width, height, kdtree_results );
+#ifdef __GLIBC__
+    // consolidates the freed kdtree++ nodes now instead of in the first large allocation of the next index
+    malloc_trim( 0 );
+#endif
+    IndexResults pool_results;
+    pool_results.m_contained_num = 0;
+    {
+        NodePool pool( sizeof(KDTree2DNode) );
+        run_kdtree_index( "index_kdtree_pool", &pool, points, queries, width, height, pool_results );
+    }
+    IndexResults bucket_results;
+    bucket_results.m_contained_num = 0;
+    {
+        BucketKDTree tree;
+        run_index( "index_bucket_kdtree", tree, points, queries, width, height, bucket_results );
+    }
+    IndexResults grid_results;
+    grid_results.m_contained_num = 0;
+    {
+        GridHashIndex index;
+        index.init( width, height, std::max( width, height ) );
+        run_index( "index_grid", index, points, queries, width, height, grid_results );
+    }
+
+    if( pool_results.m_nearest_dist != kdtree_results.m_nearest_dist
+        || pool_results.m_near_num != kdtree_results.m_near_num
+        || pool_results.m_contained_num != kdtree_results.m_contained_num ) {
+        fprintf( stderr, "index_kdtree_pool differs from index_kdtree\n" );
+    }
+    if( bucket_results.m_nearest_dist != kdtree_results.m_nearest_dist
+        || bucket_results.m_near_num != kdtree_results.m_near_num
+        || bucket_results.m_contained_num != kdtree_results.m_contained_num ) {
+        fprintf( stderr, "index_bucket_kdtree differs from index_kdtree\n" );
+    }
+    if( grid_results.m_nearest_dist != kdtree_results.m_nearest_dist
+        || grid_results.m_near_num != kdtree_results.m_near_num
+        || grid_results.m_contained_num != kdtree_results.m_contained_num ) {
+        fprintf( stderr, "index_grid differs from index_kdtree\n" );
+    }
+
+    // the worst order for an index that is never rebalanced, only the full set matches the other runs
+    std::sort( points.begin(), points.end(), is_lower_in_x );
+    IndexResults sorted_results;
+    sorted_results.m_contained_num = 0;
+    BucketKDTree sorted_tree;
+    run_index( "index_bucket_kdtree_sorted", sorted_tree, points, queries, width, height, sorted_results );
+    if( false == std::equal( sorted_results.m_nearest_dist.end() - queries.size(), sorted_results.m_nearest_dist.end(),
+                             kdtree_results.m_nearest_dist.end() - queries.size() ) ) {
+        fprintf( stderr, "index_bucket_kdtree_sorted differs from index_kdtree\n" );
+    }
+}
+
+static void print_usage( const char* name ) {
+    fprintf( stderr, "usage: %s [-d DATA_DIR] [-n MAX_NODES] [-q QUERIES] [-s SEED]\n", name );
+}
+
+static bool parse_options( int argc, char** argv, BenchOptions& options ) {
+    for( int i=1; i<argc; i++ ) {
+        if( argv[i][0] != '-' || strlen( argv[i] ) != 2 || i+1 >= argc ) {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch( argv[i-1][1] ) {
+        case 'd':
+            options.m_data_dir = value;
+            break;
+        case 'n':
+            options.m_max_node_num = atoi( value );
+            break;
+        case 'q':
+            options.m_query_num = atoi( value );
+            break;
+        case 's':
+            options.m_seed = atoi( value );
+            break;
+        default:
+            return false;
+        }
+    }
+    return options.m_query_num > 0;
+}
+
+int main( int argc, char** argv ) {
+    BenchOptions options;
+    if( false == parse_options( argc, argv, options ) ) {
+        print_usage( argv[0] );
+        return 1;
+    }
+
+    Scenario empty_map;
+    empty_map.m_name = "empty_map";
+    if( false == load_gray_image( options.m_data_dir + "/empty_map.png", empty_map.m_map ) ) {
+        fprintf( stderr, "failed to load %s/empty_map.png\n", options.m_data_dir.c_str() );
+        return 1;
+    }
+    empty_map.m_start = POS2D( 20, 20 );
+    empty_map.m_goal = POS2D( empty_map.m_map.get_width() - 20, empty_map.m_map.get_height() - 20 );
+    empty_map.m_segment_length = 10;
+    run_scenario<EuclideanCost>( empty_map, options );
+
+    // fitness1.png is an objective, planned over the empty map as in the demo
+    Scenario fitness1;
+    fitness1.m_name = "fitness1";
+    fitness1.m_map = empty_map.m_map;
+    if( false == load_gray_image( options.m_data_dir + "/fitness1.png", fitness1.m_cost_distribution ) ) {
+        fprintf( stderr, "failed to load %s/fitness1.png\n", options.m_data_dir.c_str() );
+        return 1;
+    }
+    fitness1.m_start = empty_map.m_start;
+    fitness1.m_goal = empty_map.m_goal;
+    fitness1.m_segment_length = 10;
+    run_scenario<FieldIntegralCost>( fitness1, options );
+
+    Scenario blocks;
+    blocks.m_name = "synthetic_blocks";
+    blocks.m_start = POS2D( 20, 20 );
+    blocks.m_goal = POS2D( 580, 380 );
+    make_block_map( blocks.m_map, 600, 400, 60, 7 );
+    clear_around( blocks.m_map, blocks.m_start, 10 );
+    clear_around( blocks.m_map, blocks.m_goal, 10 );
+    blocks.m_segment_length = 10;
+    run_scenario<EuclideanCost>( blocks, options );
+
+    // large enough for the 1M node checkpoint
+    Scenario large_blocks;
+    large_blocks.m_name = "synthetic_large_blocks";
+    large_blocks.m_start = POS2D( 50, 50 );
+    large_blocks.m_goal = POS2D( 2950, 2950 );
+    make_block_map( large_blocks.m_map, 3000, 3000, 400, 11 );
+    clear_around( large_blocks.m_map, large_blocks.m_start, 20 );
+    clear_around( large_blocks.m_map, large_blocks.m_goal, 20 );
+    large_blocks.m_segment_length = 20;
+    run_scenario<EuclideanCost>( large_blocks, options );
+
+    run_index_scenarios( options );
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <cstring>
+#include <vector>
+#include <png.h>
+
+#include "gray_image.h"
+
+static bool read_rgba_image( const std::string& filename, std::vector<uint8_t>& pixels, int& width, int& height ) {
+    png_image image;
+    memset( &image, 0, sizeof(image) );
+    image.version = PNG_IMAGE_VERSION;
+    if( png_image_begin_read_from_file( &image, filename.c_str() ) == 0 ) {
+        return false;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    pixels.resize( PNG_IMAGE_SIZE( image ) );
+    if( png_image_finish_read( &image, NULL, &pixels[0], 0, NULL ) == 0 ) {
+        png_image_free( &image );
+        return false;
+    }
+    width = image.width;
+    height = image.height;
+    return true;
+}
+
+bool load_gray_image( const std::string& filename, Grid<uint8_t>& gray ) {
+    std::vector<uint8_t> pixels;
+    int width = 0, height = 0;
+    if( false == read_rgba_image( filename, pixels, width, height ) ) {
+        return false;
+    }
+    gray.resize( width, height );
+    for(int j=0;j<height;j++) {
+        const uint8_t* p_src = &pixels[(size_t)j * width * 4];
+        uint8_t* p_row = gray.get_row( j );
+        for(int i=0;i<width;i++) {
+            p_row[i] = ( p_src[4*i] * 11 + p_src[4*i+1] * 16 + p_src[4*i+2] * 5 ) / 32;
+        }
+    }
+    return true;
+}
+
+bool load_gray_image( const std::string& filename, Grid<double>& gray ) {
+    Grid<uint8_t> gray_values;
+    if( false == load_gray_image( filename, gray_values ) ) {
+        return false;
+    }
+    gray.resize( gray_values.get_width(), gray_values.get_height() );
+    for(int j=0;j<gray.get_height();j++) {
+        const uint8_t* p_src = gray_values.get_row( j );
+        double* p_row = gray.get_row( j );
+        for(int i=0;i<gray.get_width();i++) {
+            p_row[i] = (double)p_src[i]/255.0;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef GRAY_IMAGE_H_
+#define GRAY_IMAGE_H_
+
+#include <string>
+
+#include "grid.h"
+
+/*
+ * PNG loading without Qt. Pixels are converted with the weights of
+ * qGray(), so a map gives the same gray values as in rrtstar-viz.
+ */
+bool load_gray_image( const std::string& filename, Grid<uint8_t>& gray );
+// gray values scaled to [0, 1], as PathPlanningInfo reads a cost distribution
+bool load_gray_image( const std::string& filename, Grid<double>& gray );
+
+#endif // GRAY_IMAGE_H_
@@ -0,0 +1,332 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <chrono>
+
+#include "rrtstar.h"
+#include "grid_file.h"
+#include "gray_image.h"
+#include "world_config.h"
+
+/*
+ * Plans the world of an rrtstar-viz config without rendering and writes
+ * the path in the format of PathPlanningInfo::export_path(). Maps and
+ * objectives are PNG images or grid files (*.grid). Flat grid files are
+ * memory-mapped, tiled ones are paged in under the memory budget of -m,
+ * each file on its own.
+ */
+
+class CliOptions {
+public:
+    CliOptions() : m_iteration_num( -1 ), m_seed( -1 ), m_worker_num( 0 ), m_time_budget( -1.0 ), m_stall_iteration_num( 0 ),
+                   m_near_index_type( BUCKET_KDTREE_INDEX ), m_tile_memory( 64 << 20 ) {}
+
+    std::string m_config_file;
+    std::string m_output_file;
+    int m_iteration_num;
+    int m_seed;
+    int m_worker_num;
+    // plan_for() instead of a fixed iteration count when set
+    double m_time_budget;
+    int m_stall_iteration_num;
+    NearIndexType m_near_index_type;
+    // bytes of tiles kept per tiled grid file
+    size_t m_tile_memory;
+};
+
+static void print_usage( const char* name ) {
+    fprintf( stderr, "usage: %s CONFIG.xml [-o PATH_FILE] [-n ITERATIONS] [-s SEED] [-w WORKERS] [-t SECONDS [-e STALL_ITERATIONS]] [-i kdtree|bucket|grid] [-m TILE_MEGABYTES]\n", name );
+}
+
+static bool parse_options( int argc, char** argv, CliOptions& options ) {
+    for( int i=1; i<argc; i++ ) {
+        if( argv[i][0] != '-' ) {
+            if( false == options.m_config_file.empty() ) {
+                return false;
+            }
+            options.m_config_file = argv[i];
+            continue;
+        }
+        if( i+1 >= argc || strlen( argv[i] ) != 2 ) {
+            return false;
+        }
+        const char* value = argv[++i];
+        switch( argv[i-1][1] ) {
+        case 'o':
+            options.m_output_file = value;
+            break;
+        case 'n':
+            options.m_iteration_num = atoi( value );
+            break;
+        case 's':
+            options.m_seed = atoi( value );
+            break;
+        case 'w':
+            options.m_worker_num = atoi( value );
+            break;
+        case 't':
+            options.m_time_budget = atof( value );
+            break;
+        case 'e':
+            options.m_stall_iteration_num = atoi( value );
+            break;
+        case 'm':
+            if( atoi( value ) <= 0 ) {
+                return false;
+            }
+            options.m_tile_memory = (size_t)atoi( value ) << 20;
+            break;
+        case 'i':
+            if( strcmp( value, "kdtree" ) == 0 ) {
+                options.m_near_index_type = KDTREE_INDEX;
+            }
+            else if( strcmp( value, "bucket" ) == 0 ) {
+                options.m_near_index_type = BUCKET_KDTREE_INDEX;
+            }
+            else if( strcmp( value, "grid" ) == 0 ) {
+                options.m_near_index_type = GRID_INDEX;
+            }
+            else {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    return false == options.m_config_file.empty();
+}
+
+static bool is_grid_file( const std::string& filename ) {
+    const std::string suffix = ".grid";
+    return filename.size() > suffix.size() && filename.compare( filename.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+static bool export_path( const std::string& filename, Path* p_path ) {
+    std::ofstream file( filename.c_str(), std::ios::out | std::ios::trunc );
+    if( false == file.is_open() ) {
+        return false;
+    }
+    file << p_path->m_cost << "\n";
+    file << "\n";
+    for( unsigned int i=0; i<p_path->m_way_points.size(); i++ ) {
+        file << p_path->m_way_points[i][0] << "," << p_path->m_way_points[i][1] << " ";
+    }
+    file << "\n";
+    return file.good();
+}
+
+static void print_stats( const ExtendStats& stats ) {
+    static const char* rejection_names[REJECTION_NUM] = { "accepted", "on_nearest", "contained", "in_obstacle", "collision" };
+    static const char* phase_names[PHASE_NUM] = { "extension", "prepare_batch", "near", "insert", "attach", "rewire" };
+    printf( "stats_samples %ld\n", stats.m_sample_num );
+    for( int i=0; i<REJECTION_NUM; i++ ) {
+        printf( "stats_extension_%s %ld\n", rejection_names[i], stats.m_extension_num[i] );
+    }
+    printf( "stats_stale_candidates %ld\n", stats.m_stale_candidate_num );
+    printf( "stats_near_queries %ld\n", stats.m_near_query_num );
+    printf( "stats_near_nodes %ld\n", stats.m_near_node_num );
+    printf( "stats_max_near_nodes %ld\n", stats.m_max_near_node_num );
+    printf( "stats_edge_evaluations %ld\n", stats.m_edge_evaluation_num );
+    printf( "stats_rewires %ld\n", stats.m_rewire_num );
+    printf( "stats_propagations %ld\n", stats.m_propagation_num );
+    if( true == ExtendStats::TIMERS_ENABLED ) {
+        for( int i=0; i<PHASE_NUM; i++ ) {
+            printf( "stats_cycles_%s %llu\n", phase_names[i], (unsigned long long)stats.m_phase_cycles[i] );
+        }
+    }
+}
+
+// what main() reports of a planning run
+class PlanResult {
+public:
+    PlanResult() : m_iteration_num( 0 ), m_node_num( 0 ), m_seconds( 0.0 ), m_stalled( false ) {}
+
+    int m_iteration_num;
+    int m_node_num;
+    double m_seconds;
+    bool m_stalled;
+    ExtendStats m_stats;
+};
+
+// the map and objective as loaded, either cells in memory or a tiled grid file
+class CliWorld {
+public:
+    CliWorld() : m_threshold( -1 ) {}
+
+    bool has_map() const { return false == m_map_view.empty() || m_tiled_map.is_open(); }
+    int get_width() const { return m_tiled_map.is_open() ? m_tiled_map.get_width() : m_map_view.get_width(); }
+    int get_height() const { return m_tiled_map.is_open() ? m_tiled_map.get_height() : m_map_view.get_height(); }
+    bool contains( POS2D pos ) const { return pos[0] >= 0 && pos[1] >= 0 && pos[0] < get_width() && pos[1] < get_height(); }
+
+    GridView<const uint8_t> m_map_view;
+    PagedGrid<uint8_t> m_tiled_map;
+    // of a grid file, -1 if none
+    int m_threshold;
+    GridView<const double> m_cost_view;
+    PagedGrid<double> m_tiled_cost;
+};
+
+// only the paged policy reads a tiled objective
+template <class COST>
+static void set_tiled_cost( COST& cost_policy, PagedGrid<double>& field ) {}
+
+static void set_tiled_cost( PagedFieldIntegralCost& cost_policy, PagedGrid<double>& field ) {
+    cost_policy.set_field( &field );
+}
+
+template <class COST>
+static Path* plan( CliWorld& world, const WorldConfig& config, int iteration_num, const CliOptions& options, PlanResult& result ) {
+    bool tiled = world.m_tiled_map.is_open();
+    RRTstarT<COST> planner( world.get_width(), world.get_height(), config.m_segment_length, tiled ? TILED_MAP : GRAY_MAP );
+    if( world.m_threshold >= 0 ) {
+        planner.set_obstacle_threshold( world.m_threshold );
+    }
+    if( true == tiled ) {
+        planner.attach_tiled_map( &world.m_tiled_map );
+    }
+    else {
+        planner.attach_map( world.m_map_view );
+    }
+    set_tiled_cost( planner.get_cost_policy(), world.m_tiled_cost );
+    planner.set_worker_num( options.m_worker_num );
+    planner.set_near_index_type( options.m_near_index_type );
+    // the cells stay in main() until the planner is gone, a memory-mapped field is not copied
+    planner.init_attached( config.m_start, config.m_goal, world.m_cost_view );
+
+    Path* p_path = NULL;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    if( options.m_time_budget >= 0.0 ) {
+        planner.set_early_termination( options.m_stall_iteration_num, 0.001 );
+        p_path = planner.plan_for( options.m_time_budget );
+    }
+    else {
+        if( options.m_worker_num > 0 ) {
+            planner.extend_n( iteration_num );
+        }
+        else {
+            // same loop as the demo, one sample per extend()
+            while( planner.get_current_iteration() < iteration_num ) {
+                planner.extend();
+            }
+        }
+        p_path = planner.find_path();
+    }
+    result.m_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+    result.m_iteration_num = planner.get_current_iteration();
+    result.m_node_num = planner.get_nodes().size();
+    result.m_stalled = planner.is_stalled();
+    result.m_stats = planner.get_stats();
+    return p_path;
+}
+
+int main( int argc, char** argv ) {
+    CliOptions options;
+    if( false == parse_options( argc, argv, options ) ) {
+        print_usage( argv[0] );
+        return 1;
+    }
+
+    WorldConfig config;
+    if( false == config.load_from_file( options.m_config_file ) ) {
+        fprintf( stderr, "failed to read world config %s\n", options.m_config_file.c_str() );
+        return 1;
+    }
+    if( options.m_seed >= 0 ) {
+        srand( options.m_seed );
+    }
+    // the demo runs until the iteration count passes the maximum
+    int iteration_num = config.m_max_iteration_num + 1;
+    if( options.m_iteration_num >= 0 ) {
+        iteration_num = options.m_iteration_num;
+    }
+    std::string output_file = options.m_output_file.empty() ? config.m_paths_output : options.m_output_file;
+
+    CliWorld world;
+    Grid<uint8_t> map;
+    GridFile map_file;
+    if( is_grid_file( config.m_map_fullpath ) ) {
+        if( true == map_file.open( config.m_map_fullpath ) ) {
+            world.m_map_view = map_file.get_uint8_grid();
+            world.m_threshold = map_file.get_threshold();
+        }
+        else if( true == world.m_tiled_map.open( config.m_map_fullpath, options.m_tile_memory ) ) {
+            world.m_threshold = world.m_tiled_map.get_threshold();
+        }
+    }
+    else if( true == load_gray_image( config.m_map_fullpath, map ) ) {
+        world.m_map_view = map;
+    }
+    if( false == world.has_map() ) {
+        fprintf( stderr, "failed to load map %s\n", config.m_map_fullpath.c_str() );
+        return 1;
+    }
+    if( false == world.contains( config.m_start ) || false == world.contains( config.m_goal ) ) {
+        fprintf( stderr, "start or goal outside of the map\n" );
+        return 1;
+    }
+
+    // the planner fits an objective of another size to the map
+    Grid<double> objective;
+    GridFile cost_file;
+    if( false == config.m_min_dist_enabled ) {
+        if( is_grid_file( config.m_objective_file ) ) {
+            if( true == cost_file.open( config.m_objective_file ) ) {
+                world.m_cost_view = cost_file.get_float64_grid();
+            }
+            else {
+                world.m_tiled_cost.open( config.m_objective_file, options.m_tile_memory );
+            }
+        }
+        else if( true == load_gray_image( config.m_objective_file, objective ) ) {
+            world.m_cost_view = objective;
+        }
+        if( world.m_cost_view.empty() && false == world.m_tiled_cost.is_open() ) {
+            fprintf( stderr, "failed to load objective %s\n", config.m_objective_file.c_str() );
+            return 1;
+        }
+    }
+
+    PlanResult result;
+    Path* p_path = NULL;
+    if( true == config.m_min_dist_enabled ) {
+        p_path = plan<EuclideanCost>( world, config, iteration_num, options, result );
+    }
+    else if( world.m_tiled_cost.is_open() ) {
+        p_path = plan<PagedFieldIntegralCost>( world, config, iteration_num, options, result );
+    }
+    else {
+        p_path = plan<FieldIntegralCost>( world, config, iteration_num, options, result );
+    }
+
+    // key value lines for scripts
+    printf( "iterations %d\n", result.m_iteration_num );
+    printf( "nodes %d\n", result.m_node_num );
+    printf( "plan_seconds %.6f\n", result.m_seconds );
+    printf( "iterations_per_second %.1f\n", result.m_seconds > 0.0 ? result.m_iteration_num / result.m_seconds : 0.0 );
+    printf( "stalled %d\n", result.m_stalled ? 1 : 0 );
+    printf( "path_found %d\n", p_path->m_way_points.empty() ? 0 : 1 );
+    printf( "path_cost %.6f\n", p_path->m_cost );
+    printf( "path_waypoints %d\n", (int)p_path->m_way_points.size() );
+    if( world.m_tiled_map.is_open() ) {
+        printf( "map_tile_loads %ld\n", world.m_tiled_map.get_cache().get_load_num() );
+    }
+    if( world.m_tiled_cost.is_open() ) {
+        printf( "objective_tile_loads %ld\n", world.m_tiled_cost.get_cache().get_load_num() );
+    }
+    if( true == ExtendStats::ENABLED ) {
+        print_stats( result.m_stats );
+    }
+
+    int ret = 0;
+    if( false == output_file.empty() ) {
+        if( false == export_path( output_file, p_path ) ) {
+            fprintf( stderr, "failed to write path %s\n", output_file.c_str() );
+            ret = 1;
+        }
+    }
+    delete p_path;
+    return ret;
+}
@@ -0,0 +1,92 @@
+#include <cstdlib>
+#include <libxml/parser.h>
+
+#include "world_config.h"
+
+static bool get_prop( xmlNodePtr node, const char* name, std::string& value ) {
+    xmlChar* tmp = xmlGetProp( node, ( const xmlChar* )( name ) );
+    if( tmp == NULL ) {
+        return false;
+    }
+    value = ( char * )( tmp );
+    xmlFree( tmp );
+    return true;
+}
+
+WorldConfig::WorldConfig() {
+    m_map_filename = "";
+    m_map_fullpath = "";
+    m_objective_file = "";
+    m_start = POS2D( -1, -1 );
+    m_goal = POS2D( -1, -1 );
+
+    m_paths_output = "";
+    m_min_dist_enabled = false;
+
+    m_max_iteration_num = 100;
+    m_segment_length = 5.0;
+    m_map_width = 0;
+    m_map_height = 0;
+}
+
+void WorldConfig::read( xmlNodePtr root ) {
+    if( root->type != XML_ELEMENT_NODE ) {
+        return;
+    }
+    std::string value;
+    get_prop( root, "map_filename", m_map_filename );
+    get_prop( root, "map_fullpath", m_map_fullpath );
+    if( get_prop( root, "map_width", value ) ) {
+        m_map_width = strtol( value.c_str(), NULL, 10 );
+    }
+    // older configs were saved with the height under "height_width"
+    if( get_prop( root, "map_height", value ) || get_prop( root, "height_width", value ) ) {
+        m_map_height = strtol( value.c_str(), NULL, 10 );
+    }
+    int start_x = 0, start_y = 0;
+    if( get_prop( root, "start_x", value ) ) {
+        start_x = strtol( value.c_str(), NULL, 10 );
+    }
+    if( get_prop( root, "start_y", value ) ) {
+        start_y = strtol( value.c_str(), NULL, 10 );
+    }
+    m_start = POS2D( start_x, start_y );
+    int goal_x = 0, goal_y = 0;
+    if( get_prop( root, "goal_x", value ) ) {
+        goal_x = strtol( value.c_str(), NULL, 10 );
+    }
+    if( get_prop( root, "goal_y", value ) ) {
+        goal_y = strtol( value.c_str(), NULL, 10 );
+    }
+    m_goal = POS2D( goal_x, goal_y );
+    if( get_prop( root, "min_dist_enabled", value ) ) {
+        m_min_dist_enabled = strtol( value.c_str(), NULL, 10 ) > 0;
+    }
+    get_prop( root, "objective_file", m_objective_file );
+    get_prop( root, "path_output_file", m_paths_output );
+    if( get_prop( root, "max_iteration_num", value ) ) {
+        m_max_iteration_num = strtol( value.c_str(), NULL, 10 );
+    }
+    if( get_prop( root, "segment_length", value ) ) {
+        m_segment_length = strtof( value.c_str(), NULL );
+    }
+}
+
+bool WorldConfig::load_from_file( const std::string& filename ) {
+    xmlDoc* doc = xmlReadFile( filename.c_str(), NULL, 0 );
+    if( doc == NULL ) {
+        return false;
+    }
+    bool found = false;
+    xmlNodePtr root = xmlDocGetRootElement( doc );
+    if( root != NULL && root->type == XML_ELEMENT_NODE ) {
+        for( xmlNodePtr l1 = root->children; l1; l1 = l1->next ) {
+            if( l1->type == XML_ELEMENT_NODE && xmlStrcmp( l1->name, ( const xmlChar * )( "world" ) ) == 0 ) {
+                read( l1 );
+                found = true;
+            }
+        }
+    }
+    xmlFreeDoc( doc );
+    return found;
+}
@@ -0,0 +1,37 @@
+#ifndef WORLD_CONFIG_H_
+#define WORLD_CONFIG_H_
+
+#include <string>
+#include <libxml/tree.h>
+
+#include "KDTree2D.h"
+
+/*
+ * The <world> element of a planning config as saved by PathPlanningInfo,
+ * read without Qt.
+ */
+class WorldConfig {
+public:
+    WorldConfig();
+
+    bool load_from_file( const std::string& filename );
+    void read( xmlNodePtr root );
+
+    /* Member variables */
+    std::string m_map_filename;
+    std::string m_map_fullpath;
+    int m_map_width;
+    int m_map_height;
+
+    POS2D m_start;
+    POS2D m_goal;
+
+    std::string m_paths_output;
+    bool m_min_dist_enabled;
+    std::string m_objective_file;
+
+    int m_max_iteration_num;
+    double m_segment_length;
+};
+
+#endif // WORLD_CONFIG_H_
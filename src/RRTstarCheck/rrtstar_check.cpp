@@ -0,0 +1,285 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+#include "rrtstar.h"
+#include "grid_file.h"
+
+/*
+ * Self-checks of the planner that run in seconds, registered with ctest.
+ * Each check prints one line per case and fails with exit status 1.
+ *
+ *   extend_allocations  for each map and NearIndexType, extend() makes no
+ *                       heap allocation once the planner reserved room
+ *                       for the tree
+ *   tiled_map           for each map, planning on tiled grid files paged
+ *                       in under a budget of a third of their tiles grows
+ *                       the same tree as planning on the gray map, with
+ *                       the cost field paged in as well
+ */
+
+// operator new of the whole process, the planner library included
+static long g_allocation_num = 0;
+
+void* operator new( size_t size ) {
+    g_allocation_num++;
+    void* p = malloc( size > 0 ? size : 1 );
+    if( p == NULL ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete( void* p ) noexcept {
+    free( p );
+}
+
+static const int CHECK_SEED = 1;
+static const int ALLOCATION_CHECK_NODE_NUM = 2000;
+static const int TILED_CHECK_ITERATION_NUM = 1500;
+static const int CHECK_TILE_SIZE = 64;
+// of the 70 tiles of a check map
+static const int CHECK_RESIDENT_TILE_NUM = 24;
+
+class CheckMap {
+public:
+    std::string   m_name;
+    Grid<uint8_t> m_map;
+    Grid<double>  m_cost_distribution;
+    POS2D m_start;
+    POS2D m_goal;
+    int   m_segment_length;
+};
+
+// rectangles of random size at random places, kept off the start and goal
+static void make_block_map( CheckMap& map, int width, int height, int block_num, int seed ) {
+    map.m_map.resize( width, height, 255 );
+    srand( seed );
+    for( int k=0; k<block_num; k++ ) {
+        int block_width = 5 + rand() % ( width / 20 );
+        int block_height = 5 + rand() % ( height / 20 );
+        int x0 = rand() % ( width - block_width );
+        int y0 = rand() % ( height - block_height );
+        for( int j=y0; j<y0+block_height; j++ ) {
+            uint8_t* p_row = map.m_map.get_row( j );
+            std::fill( p_row + x0, p_row + x0 + block_width, 0 );
+        }
+    }
+    for( int j=0; j<height; j++ ) {
+        for( int i=0; i<width; i++ ) {
+            if( map.m_start.distance_to( POS2D( i, j ) ) <= 10.0 || map.m_goal.distance_to( POS2D( i, j ) ) <= 10.0 ) {
+                map.m_map( i, j ) = 255;
+            }
+        }
+    }
+}
+
+// a field with some structure for the integral cost to follow
+static void make_cost_distribution( CheckMap& map ) {
+    int width = map.m_map.get_width();
+    int height = map.m_map.get_height();
+    map.m_cost_distribution.resize( width, height, 0.0 );
+    for( int j=0; j<height; j++ ) {
+        for( int i=0; i<width; i++ ) {
+            map.m_cost_distribution( i, j ) = ( ( i / 40 + j / 40 ) % 2 == 0 ) ? 1.0 : 4.0;
+        }
+    }
+}
+
+static void make_check_maps( std::vector<CheckMap>& maps ) {
+    maps.resize( 3 );
+    for( unsigned int k=0; k<maps.size(); k++ ) {
+        maps[k].m_start = POS2D( 20, 20 );
+        maps[k].m_goal = POS2D( 580, 380 );
+        maps[k].m_segment_length = 10;
+        maps[k].m_map.resize( 600, 400, 255 );
+    }
+    maps[0].m_name = "empty_map";
+    maps[1].m_name = "field";
+    make_cost_distribution( maps[1] );
+    maps[2].m_name = "blocks";
+    make_block_map( maps[2], 600, 400, 60, 7 );
+}
+
+/*
+ * Grows a tree with room reserved for its nodes and counts the heap
+ * allocations of its extend() calls, false if there were any.
+ */
+template <class COST>
+static bool check_extend_allocations( const CheckMap& map, NearIndexType index_type, const char* index_name ) {
+    srand( CHECK_SEED );
+    RRTstarT<COST> planner( map.m_map.get_width(), map.m_map.get_height(), map.m_segment_length );
+    planner.set_near_index_type( index_type );
+    planner.attach_map( map.m_map );
+    planner.init_attached( map.m_start, map.m_goal, map.m_cost_distribution );
+    planner.reserve( ALLOCATION_CHECK_NODE_NUM );
+
+    int extend_num = ALLOCATION_CHECK_NODE_NUM - (int)planner.get_nodes().size();
+    long allocation_num = g_allocation_num;
+    for( int i=0; i<extend_num; i++ ) {
+        planner.extend();
+    }
+    allocation_num = g_allocation_num - allocation_num;
+    printf( "extend_allocations %s %s: %d extend() calls, %ld allocations\n", map.m_name.c_str(), index_name, extend_num, allocation_num );
+    return allocation_num == 0;
+}
+
+static bool check_extend_allocations() {
+    std::vector<CheckMap> maps;
+    make_check_maps( maps );
+    bool passed = true;
+    for( unsigned int k=0; k<maps.size(); k++ ) {
+        if( maps[k].m_cost_distribution.empty() ) {
+            passed = check_extend_allocations<EuclideanCost>( maps[k], KDTREE_INDEX, "kdtree" ) && passed;
+            passed = check_extend_allocations<EuclideanCost>( maps[k], BUCKET_KDTREE_INDEX, "bucket" ) && passed;
+            passed = check_extend_allocations<EuclideanCost>( maps[k], GRID_INDEX, "grid" ) && passed;
+        }
+        else {
+            passed = check_extend_allocations<FieldIntegralCost>( maps[k], KDTREE_INDEX, "kdtree" ) && passed;
+            passed = check_extend_allocations<FieldIntegralCost>( maps[k], BUCKET_KDTREE_INDEX, "bucket" ) && passed;
+            passed = check_extend_allocations<FieldIntegralCost>( maps[k], GRID_INDEX, "grid" ) && passed;
+        }
+    }
+    return passed;
+}
+
+class TreeSummary {
+public:
+    double m_path_cost;
+    // of every node, compares whole trees
+    double m_cost_sum;
+    unsigned int m_node_num;
+};
+
+template <class COST>
+static void grow_tree( RRTstarT<COST>& planner, const CheckMap& map, GridView<const double> cost_distribution, TreeSummary& summary ) {
+    srand( CHECK_SEED );
+    planner.init_attached( map.m_start, map.m_goal, cost_distribution );
+    while( planner.get_current_iteration() < TILED_CHECK_ITERATION_NUM ) {
+        planner.extend();
+    }
+    Path* p_path = planner.find_path();
+    summary.m_path_cost = p_path->m_cost;
+    summary.m_node_num = planner.get_nodes().size();
+    summary.m_cost_sum = 0.0;
+    for( RRTNodeArena::iterator it = planner.get_nodes().begin(); it != planner.get_nodes().end(); it++ ) {
+        summary.m_cost_sum += (*it)->m_cost;
+    }
+    delete p_path;
+}
+
+/*
+ * Plans the map once from its cells and once from tiled grid files of
+ * the map and the cost field, false if the trees differ or if the tiles
+ * never had to be evicted.
+ */
+static bool check_tiled_map( const CheckMap& map ) {
+    int width = map.m_map.get_width();
+    int height = map.m_map.get_height();
+    std::string map_filename = "rrtstar_check_" + map.m_name + "_map.grid";
+    std::string field_filename = "rrtstar_check_" + map.m_name + "_field.grid";
+    bool has_field = false == map.m_cost_distribution.empty();
+
+    bool written = save_tiled_grid_file( map_filename, map.m_map, CHECK_TILE_SIZE, -1 );
+    if( true == has_field ) {
+        written = save_tiled_grid_file( field_filename, map.m_cost_distribution, CHECK_TILE_SIZE ) && written;
+    }
+    PagedGrid<uint8_t> tiled_map;
+    PagedGrid<double> tiled_field;
+    bool opened = written && tiled_map.open( map_filename, CHECK_RESIDENT_TILE_NUM * CHECK_TILE_SIZE * CHECK_TILE_SIZE * sizeof(uint8_t) );
+    if( true == has_field ) {
+        opened = opened && tiled_field.open( field_filename, CHECK_RESIDENT_TILE_NUM * CHECK_TILE_SIZE * CHECK_TILE_SIZE * sizeof(double) );
+    }
+    if( false == opened ) {
+        printf( "tiled_map %s: failed to write or open the tiled grid files\n", map.m_name.c_str() );
+        remove( map_filename.c_str() );
+        remove( field_filename.c_str() );
+        return false;
+    }
+
+    TreeSummary gray_summary;
+    TreeSummary tiled_summary;
+    if( false == has_field ) {
+        RRTstarT<EuclideanCost> gray_planner( width, height, map.m_segment_length );
+        gray_planner.attach_map( map.m_map );
+        grow_tree( gray_planner, map, GridView<const double>(), gray_summary );
+
+        RRTstarT<EuclideanCost> tiled_planner( width, height, map.m_segment_length, TILED_MAP );
+        tiled_planner.attach_tiled_map( &tiled_map );
+        grow_tree( tiled_planner, map, GridView<const double>(), tiled_summary );
+    }
+    else {
+        RRTstarT<FieldIntegralCost> gray_planner( width, height, map.m_segment_length );
+        gray_planner.attach_map( map.m_map );
+        grow_tree( gray_planner, map, map.m_cost_distribution, gray_summary );
+
+        RRTstarT<PagedFieldIntegralCost> tiled_planner( width, height, map.m_segment_length, TILED_MAP );
+        tiled_planner.attach_tiled_map( &tiled_map );
+        tiled_planner.get_cost_policy().set_field( &tiled_field );
+        grow_tree( tiled_planner, map, GridView<const double>(), tiled_summary );
+    }
+    remove( map_filename.c_str() );
+    remove( field_filename.c_str() );
+
+    long load_num = tiled_map.get_cache().get_load_num();
+    printf( "tiled_map %s: %u nodes, cost sum %f, path cost %f, gray map %u nodes, cost sum %f, path cost %f, %ld tile loads into %d slots\n",
+            map.m_name.c_str(), tiled_summary.m_node_num, tiled_summary.m_cost_sum, tiled_summary.m_path_cost,
+            gray_summary.m_node_num, gray_summary.m_cost_sum, gray_summary.m_path_cost, load_num, tiled_map.get_cache().get_slot_num() );
+    return tiled_summary.m_node_num == gray_summary.m_node_num
+        && fabs( tiled_summary.m_cost_sum - gray_summary.m_cost_sum ) <= 1e-9 * std::max( 1.0, gray_summary.m_cost_sum )
+        && fabs( tiled_summary.m_path_cost - gray_summary.m_path_cost ) <= 1e-9 * std::max( 1.0, gray_summary.m_path_cost )
+        && load_num > tiled_map.get_cache().get_slot_num();
+}
+
+static bool check_tiled_map() {
+    std::vector<CheckMap> maps;
+    make_check_maps( maps );
+    bool passed = true;
+    for( unsigned int k=0; k<maps.size(); k++ ) {
+        passed = check_tiled_map( maps[k] ) && passed;
+    }
+    return passed;
+}
+
+typedef bool (*CHECK_FUNC_PTR)();
+
+class Check {
+public:
+    const char*    mp_name;
+    CHECK_FUNC_PTR mp_func;
+};
+
+static const Check CHECKS[] = {
+    { "extend_allocations", check_extend_allocations },
+    { "tiled_map", check_tiled_map }
+};
+static const int CHECK_NUM = sizeof(CHECKS) / sizeof(CHECKS[0]);
+
+int main( int argc, char** argv ) {
+    if( argc > 2 ) {
+        fprintf( stderr, "usage: %s [CHECK]\n", argv[0] );
+        return 1;
+    }
+    bool found = false;
+    bool passed = true;
+    for( int i=0; i<CHECK_NUM; i++ ) {
+        if( argc == 2 && strcmp( argv[1], CHECKS[i].mp_name ) != 0 ) {
+            continue;
+        }
+        found = true;
+        if( false == CHECKS[i].mp_func() ) {
+            fprintf( stderr, "%s failed\n", CHECKS[i].mp_name );
+            passed = false;
+        }
+    }
+    if( false == found ) {
+        fprintf( stderr, "unknown check %s\n", argv[1] );
+        return 1;
+    }
+    return passed ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <list>
+#include <algorithm>
 #include <QPixmap>
 #include <QFile>
 
@@ -23,62 +24,63 @@ PathPlanningInfo::PathPlanningInfo() {
 
     m_max_iteration_num = 100;
     m_segment_length = 5.0;
-    mCostDistribution = NULL;
-
     m_map_width = 0;
     m_map_height = 0;
 }
 
-bool PathPlanningInfo::get_obstacle_info( int** pp_obstacle_info ) {
-    if( pp_obstacle_info==NULL ) {
+bool PathPlanningInfo::get_obstacle_info( GridView<uint8_t> obstacle_info ) {
+    if( obstacle_info.empty() ) {
         return false;
     }
-    return get_pix_info( m_map_fullpath, pp_obstacle_info );
+    return get_pix_info( m_map_fullpath, obstacle_info );
 }
 
-bool PathPlanningInfo::get_cost_distribution( double** pp_cost_distribution ) {
-    return get_pix_info( m_objective_file, pp_cost_distribution );
+bool PathPlanningInfo::get_cost_distribution( GridView<double> cost_distribution ) {
+    return get_pix_info( m_objective_file, cost_distribution );
 }
 
-bool PathPlanningInfo::get_pix_info( QString filename, double** pp_pix_info ) {
-    if( pp_pix_info==NULL ) {
+bool PathPlanningInfo::get_pix_info( QString filename, GridView<double> pix_info ) {
+    if( pix_info.empty() ) {
         return false;
     }
     QPixmap map(filename);
     QImage gray_img = map.toImage();
-    int width = map.width();
-    int height = map.height();
+    int width = std::min( map.width(), pix_info.get_width() );
+    int height = std::min( map.height(), pix_info.get_height() );
 
-    for(int i=0;i<width;i++) {
-        for(int j=0;j<height;j++) {
+    // row by row, the grid is row-major
+    for(int j=0;j<height;j++) {
+        double* p_row = pix_info.get_row(j);
+        for(int i=0;i<width;i++) {
             QRgb col = gray_img.pixel(i,j);
             int g_val = qGray(col);
             if( g_val < 0 || g_val > 255 ) {
                 qWarning() << "gray value out of range";
             }
-            pp_pix_info[i][j] = (double)g_val/255.0;
+            p_row[i] = (double)g_val/255.0;
         }
     }
     return true;
 }
 
-bool PathPlanningInfo::get_pix_info(QString filename, int ** pp_pix_info) {
-    if( pp_pix_info==NULL ) {
+bool PathPlanningInfo::get_pix_info( QString filename, GridView<uint8_t> pix_info ) {
+    if( pix_info.empty() ) {
         return false;
     }
     QPixmap map(filename);
     QImage gray_img = map.toImage();
-    int width = map.width();
-    int height = map.height();
+    int width = std::min( map.width(), pix_info.get_width() );
+    int height = std::min( map.height(), pix_info.get_height() );
 
-    for(int i=0;i<width;i++) {
-        for(int j=0;j<height;j++) {
+    for(int j=0;j<height;j++) {
+        uint8_t* p_row = pix_info.get_row(j);
+        for(int i=0;i<width;i++) {
             QRgb col = gray_img.pixel(i,j);
             int g_val = qGray(col);
             if( g_val < 0 || g_val > 255 ) {
                 qWarning() << "gray value out of range";
             }
-            pp_pix_info[i][j] = g_val;
+            p_row[i] = g_val;
         }
     }
     return true;
@@ -88,18 +90,11 @@ bool PathPlanningInfo::get_pix_info(QString filename, int ** pp_pix_info) {
 void PathPlanningInfo::init_func_param() {
     if( m_min_dist_enabled == true ) {
         mp_func = PathPlanningInfo::calc_dist;
-        mCostDistribution = NULL;
+        mCostDistribution.clear();
     }
     else {
-        mp_func = PathPlanningInfo::calc_cost;
-        if(mCostDistribution) {
-            delete[] mCostDistribution;
-            mCostDistribution = NULL;
-        }
-        mCostDistribution = new double*[m_map_width];
-        for(int i=0;i<m_map_width;i++) {
-            mCostDistribution[i] = new double[m_map_height];
-        }
+        mp_func = calc_field_cost;
+        mCostDistribution.resize( m_map_width, m_map_height );
         get_cost_distribution( mCostDistribution );
     }
 }
@@ -288,10 +283,10 @@ void PathPlanningInfo::dump_cost_distribution( QString filename ) {
     if( file.open(QIODevice::ReadWrite) ) {
         QTextStream stream( & file );
 
-        if( mCostDistribution ) {
-            for(int i=0;i<m_map_width;i++) {
-                for(int j=0;j<m_map_height;j++) {
-                    stream << mCostDistribution[i][j] << " ";
+        if( false == mCostDistribution.empty() ) {
+            for(int i=0;i<mCostDistribution.get_width();i++) {
+                for(int j=0;j<mCostDistribution.get_height();j++) {
+                    stream << mCostDistribution(i,j) << " ";
                 }
                 stream << "\n";
             }
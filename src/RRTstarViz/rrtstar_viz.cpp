@@ -22,7 +22,8 @@ void RRTstarViz::paintEvent( QPaintEvent * e ) {
         paintpen.setWidth(1);
         painter.setPen(paintpen);
 
-        for( std::list<RRTNode*>::iterator it= mp_tree->get_nodes().begin(); it!=mp_tree->get_nodes().end();it++ ) {
+        RRTNodeArena& nodes = mp_tree->get_nodes();
+        for( RRTNodeArena::iterator it= nodes.begin(); it!=nodes.end();it++ ) {
             RRTNode* p_node = (*it);
             if(p_node) {
                 if(p_node->mp_parent) {
@@ -30,12 +31,8 @@ void RRTstarViz::paintEvent( QPaintEvent * e ) {
                 }
 
                 /*
-                for(std::list<RRTNode*>::iterator itc= p_node->m_child_nodes.begin(); itc!=p_node->m_child_nodes.end();itc++) {
-                    RRTNode* p_child_node = (*itc);
-                    if(p_child_node)
-                    {
-                        painter.drawLine(QPoint(p_node->m_pos[0], p_node->m_pos[1]), QPoint(p_child_node->m_pos[0], p_child_node->m_pos[1]));
-                    }
+                for(RRTNode* p_child_node= p_node->mp_first_child; p_child_node!=NULL; p_child_node=p_child_node->mp_next_sibling) {
+                    painter.drawLine(QPoint(p_node->m_pos[0], p_node->m_pos[1]), QPoint(p_child_node->m_pos[0], p_child_node->m_pos[1]));
                 }*/
             }
         }
@@ -215,8 +215,10 @@ void MainWindow::planPath() {
     POS2D start(mpViz->m_PPInfo.m_start.x(), mpViz->m_PPInfo.m_start.y());
     POS2D goal(mpViz->m_PPInfo.m_goal.x(), mpViz->m_PPInfo.m_goal.y());
 
-    mpRRTstar->init(start, goal, mpViz->m_PPInfo.mp_func, mpViz->m_PPInfo.mCostDistribution);
+    // init() already checks the root's goal connection against the map
     mpViz->m_PPInfo.get_obstacle_info(mpRRTstar->get_map_info());
+    mpRRTstar->update_map_info();
+    mpRRTstar->init(start, goal, mpViz->m_PPInfo.mp_func, mpViz->m_PPInfo.mCostDistribution);
     mpViz->setTree(mpRRTstar);
 
     mpRRTstar->dump_distribution("dist.txt");
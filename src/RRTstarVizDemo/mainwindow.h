@@ -11,7 +11,6 @@
 #include "rrtstar_viz.h"
 
 class ConfigObjDialog;
-class RRTstar;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT